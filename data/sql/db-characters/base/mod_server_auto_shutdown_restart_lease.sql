@@ -0,0 +1,9 @@
+-- Restart leases shared by the realms of one database cluster (ServerAutoShutdown.Lease.*)
+CREATE TABLE IF NOT EXISTS `mod_server_auto_shutdown_restart_lease` (
+    `slot` INT UNSIGNED NOT NULL,
+    `realm_id` INT UNSIGNED NOT NULL,
+    `pid` INT UNSIGNED NOT NULL DEFAULT 0,
+    `expire_time` INT UNSIGNED NOT NULL,
+    PRIMARY KEY (`slot`),
+    UNIQUE KEY `realm_id` (`realm_id`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
@@ -0,0 +1,7 @@
+-- Scratch table of the synthetic save benchmark (.autoshutdown savebench), emptied after every run
+CREATE TABLE IF NOT EXISTS `mod_server_auto_shutdown_save_bench` (
+    `guid` INT UNSIGNED NOT NULL,
+    `slot` INT UNSIGNED NOT NULL,
+    `data` TEXT NOT NULL,
+    PRIMARY KEY (`guid`, `slot`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
@@ -16,24 +16,82 @@
  */
 
 #include "ServerAutoShutdown.h"
+#include "ServerAutoShutdownAllocator.h"
+#include "ServerAutoShutdownCost.h"
+#include "ServerAutoShutdownDump.h"
+#include "ServerAutoShutdownProfiler.h"
+#include "ServerAutoShutdownSampler.h"
+#include "ServerAutoShutdownSettings.h"
+#include "ServerAutoShutdownWatcher.h"
+#include "AsyncCallbackProcessor.h"
 #include "Config.h"
+#include "DatabaseEnv.h"
 #include "Duration.h"
 #include "GameEventMgr.h"
+#include "GameTime.h"
 #include "Language.h"
+#include "LFGMgr.h"
 #include "Log.h"
+#include "MapMgr.h"
 #include "ObjectMgr.h"
+#include "Player.h"
+#include "QueryCallback.h"
+#include "Random.h"
+#include "Realm.h"
 #include "StringConvert.h"
 #include "StringFormat.h"
 #include "TaskScheduler.h"
 #include "Tokenize.h"
+#include "Transaction.h"
 #include "Util.h"
 #include "World.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
 
 namespace
 {
     // Scheduler - for update
     TaskScheduler scheduler;
 
+    // Database probes - for update
+    QueryCallbackProcessor queryProcessor;
+
+    // Save benchmark commits - for update
+    AsyncCallbackProcessor<TransactionCallback> transactionProcessor;
+
+    // Kept outside of the config for the exit handler
+    std::string timelineFile;
+
+    // One json object per line, for the restart benchmark tooling
+    void WriteTimeline(std::string_view event, std::string_view extra)
+    {
+        if (timelineFile.empty())
+            return;
+
+        std::ofstream file(timelineFile, std::ios::app);
+        if (!file)
+            return;
+
+        auto now = std::chrono::duration_cast<Milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        file << "{\"event\":\"" << event << "\",\"time_ms\":" << now << ",\"pid\":" << GetPID();
+        if (!extra.empty())
+            file << ',' << extra;
+        file << "}\n";
+    }
+
+    constexpr std::array<char const*, MAX_SAS_DATABASE_POOLS> DatabasePoolNames =
+    {
+        "Login",
+        "World",
+        "Character"
+    };
+
     time_t GetNextResetTime(time_t time, uint32 day, uint8 hour, uint8 minute, uint8 second)
     {
         tm timeLocal = Acore::Time::TimeBreakdown(time);
@@ -48,79 +106,208 @@ namespace
 
         return midnightLocal;
     }
-}
 
-/*static*/ ServerAutoShutdown* ServerAutoShutdown::instance()
-{
-    static ServerAutoShutdown instance;
-    return &instance;
-}
+    // Next reset boundary at or after the earliest time of the core resets in the mask, 0 if none
+    time_t GetNextCoreResetTime(uint32 mask, time_t earliest)
+    {
+        struct CoreReset
+        {
+            SASCoreReset Flag;
+            time_t Time;
+            time_t Period;  // 0 - can't be moved forward
+        };
 
-void ServerAutoShutdown::Init()
-{
-    _isEnableModule = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Enabled", false);
+        std::array<CoreReset, 6> resets =
+        { {
+            { SAS_RESET_DAILY_QUESTS,   time_t(sWorld->getWorldState(WS_DAILY_QUEST_RESET_TIME)),   DAY },
+            { SAS_RESET_WEEKLY_QUESTS,  time_t(sWorld->getWorldState(WS_WEEKLY_QUEST_RESET_TIME)),  WEEK },
+            { SAS_RESET_MONTHLY_QUESTS, time_t(sWorld->getWorldState(WS_MONTHLY_QUEST_RESET_TIME)), 0 },
+            { SAS_RESET_BATTLEGROUND,   time_t(sWorld->getWorldState(WS_BG_DAILY_RESET_TIME)),      DAY },
+            { SAS_RESET_ARENA_POINTS,   time_t(sWorld->getWorldState(WS_ARENA_DISTRIBUTION_TIME)),  time_t(DAY * sWorld->getIntConfig(CONFIG_ARENA_AUTO_DISTRIBUTE_INTERVAL_DAYS)) },
+            { SAS_RESET_INSTANCES,      GetNextResetTime(time(nullptr), 1, sWorld->getIntConfig(CONFIG_INSTANCE_RESET_TIME_HOUR), 0, 0), DAY }
+        } };
 
-    if (!_isEnableModule)
-        return;
+        time_t next = 0;
 
-    std::string configTime = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Time", "04:00:00");
-    auto const& tokens = Acore::Tokenize(configTime, ':', false);
+        for (CoreReset reset : resets)
+        {
+            if (!(mask & reset.Flag) || !reset.Time)
+                continue;
+
+            while (reset.Period && reset.Time < earliest)
+                reset.Time += reset.Period;
+
+            if (reset.Time >= earliest && (!next || reset.Time < next))
+                next = reset.Time;
+        }
 
-    if (tokens.size() != 3)
+        return next;
+    }
+
+    // Table written by a statement digest, empty for reads
+    std::string GetWrittenTable(std::string const& digest)
     {
-        LOG_ERROR("module", "> ServerAutoShutdown: Incorrect time in config option 'ServerAutoShutdown.Time' - '{}'", configTime);
-        _isEnableModule = false;
-        return;
+        // "INSERT INTO `character_aura` ...", "UPDATE `characters` SET ...", "DELETE FROM `item_instance` ..."
+        for (std::string_view prefix : { "INSERT INTO ", "REPLACE INTO ", "UPDATE ", "DELETE FROM " })
+        {
+            if (digest.rfind(prefix, 0) != 0)
+                continue;
+
+            std::size_t start = prefix.size();
+            std::size_t end = digest.find_first_of(" (", start);
+            std::string table = digest.substr(start, end == std::string::npos ? std::string::npos : end - start);
+
+            table.erase(std::remove(table.begin(), table.end(), '`'), table.end());
+            return table;
+        }
+
+        return "";
+    }
+
+    // Statement on the pool named in the config - Login, World or Character (default)
+    QueryResult DatabaseQuery(std::string const& database, std::string const& sql, bool execute = false)
+    {
+        auto Run = [&sql, execute](auto& pool) -> QueryResult
+        {
+            if (!execute)
+                return pool.Query(sql);
+
+            pool.DirectExecute(sql);
+            return nullptr;
+        };
+
+        if (StringEqualI(database, "World"))
+            return Run(WorldDatabase);
+
+        if (StringEqualI(database, "Login"))
+            return Run(LoginDatabase);
+
+        return Run(CharacterDatabase);
+    }
+
+    // All buffer pool statements go to one database, which is enough as the pool is server wide
+    QueryResult BufferPoolQuery(std::string const& sql, bool execute = false)
+    {
+        return DatabaseQuery(ServerAutoShutdownSettings::Get()->BufferPoolDatabase, sql, execute);
     }
 
-    // Check convert to int
-    auto CheckTime = [tokens](std::initializer_list<uint8> index)
+    // Until the character database async queue is empty and its last statement done, false on timeout
+    bool WaitForCharacterWrites(Seconds timeout)
     {
-        for (auto const& itr : index)
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (CharacterDatabase.QueueSize())
         {
-            if (!Acore::StringTo<uint8>(tokens.at(itr)))
+            if (std::chrono::steady_clock::now() >= deadline)
                 return false;
+
+            std::this_thread::sleep_for(Milliseconds(10));
         }
 
-        return true;
-    };
+        // The queue is empty once the last task is taken, the marker runs after it (one async connection by default)
+        QueryCallback marker = CharacterDatabase.AsyncQuery("SELECT 1");
+        marker.WithCallback([](QueryResult /*result*/) { });
 
-    if (!CheckTime({ 0, 1, 2 }))
-    {
-        LOG_ERROR("module", "> ServerAutoShutdown: Incorrect time in config option 'ServerAutoShutdown.Time' - '{}'", configTime);
-        _isEnableModule = false;
-        return;
+        while (!marker.InvokeIfReady())
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+
+            std::this_thread::sleep_for(Milliseconds(10));
+        }
+
+        return true;
     }
 
-    uint32 day =  sConfigMgr->GetOption<uint32>("ServerAutoShutdown.EveryDays", 1);
-    uint8 hour = *Acore::StringTo<uint8>(tokens.at(0));
-    uint8 minute = *Acore::StringTo<uint8>(tokens.at(1));
-    uint8 second = *Acore::StringTo<uint8>(tokens.at(2));
+    // Time the process must be gone by, 0 - disarmed
+    std::atomic<time_t> watchdogDeadline{ 0 };
+    std::once_flag watchdogStarted;
 
-    if (day < 1 || day > 365)
+    // Detached, a stuck world or teardown can't block it and it never blocks the exit
+    void StartWatchdog()
     {
-        LOG_ERROR("module", "> ServerAutoShutdown: Incorrect day in config option 'ServerAutoShutdown.EveryDays' - '{}'", day);
-        _isEnableModule = false;
+        std::call_once(watchdogStarted, []
+        {
+            std::thread([]
+            {
+                while (true)
+                {
+                    std::this_thread::sleep_for(Seconds(1));
+
+                    time_t deadline = watchdogDeadline.load();
+                    if (!deadline || time(nullptr) < deadline)
+                        continue;
+
+                    LOG_ERROR("module", "> ServerAutoShutdown: Watchdog - the server is still running after the shutdown deadline, forced exit");
+                    WriteTimeline("watchdog", {});
+                    std::_Exit(SHUTDOWN_EXIT_CODE);
+                }
+            }).detach();
+        });
     }
-    else if (hour > 23)
+
+    // Single quoted for the shell
+    std::string ShellQuote(std::string const& text)
     {
-        LOG_ERROR("module", "> ServerAutoShutdown: Incorrect hour in config option 'ServerAutoShutdown.Time' - '{}'", configTime);
-        _isEnableModule = false;
+        std::string quoted = "'";
+
+        for (char c : text)
+        {
+            if (c == '\'')
+                quoted += "'\\''";
+            else
+                quoted += c;
+        }
+
+        return quoted + "'";
     }
-    else if (minute >= 60)
+}
+
+/*static*/ ServerAutoShutdown* ServerAutoShutdown::instance()
+{
+    static ServerAutoShutdown instance;
+    return &instance;
+}
+
+void ServerAutoShutdown::Init()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    sSASCost->SetEnabled(settings->SelfCostEnabled);
+    SASCostScope costScope(SAS_COST_INIT);
+
+    _isEnableModule = settings->Enabled;
+
+    uint32 day = settings->EveryDays;
+
+    if (_isEnableModule && !settings->Time)
+        _isEnableModule = false;
+
+    if (_isEnableModule && (day < 1 || day > 365))
     {
-        LOG_ERROR("module", "> ServerAutoShutdown: Incorrect minute in config option 'ServerAutoShutdown.Time' - '{}'", configTime);
+        LOG_ERROR("module", "> ServerAutoShutdown: Incorrect day in config option 'ServerAutoShutdown.EveryDays' - '{}'", day);
         _isEnableModule = false;
     }
-    else if (second >= 60)
+
+    // Nothing of a previous config goes on, least of all the forced exit
+    if (!_isEnableModule)
     {
-        LOG_ERROR("module", "> ServerAutoShutdown: Incorrect second in config option 'ServerAutoShutdown.Time' - '{}'", configTime);
-        _isEnableModule = false;
+        scheduler.CancelGroup(SAS_GROUP_SHUTDOWN);
+        scheduler.CancelGroup(SAS_GROUP_COUNTDOWN);
+        DisarmWatchdog();
+        StopProfile();
+        sSASSampler->Stop();
+        sSASWatcher->Stop();
+        return;
     }
 
     auto nowTime = time(nullptr);
     //Seconds nowTime = GameTime::GetGameTime();
-    uint64 nextResetTime = GetNextResetTime(nowTime, day, hour, minute, second);
+
+    // A cancelled daily restart isn't announced again, the next one is
+    time_t baseTime = std::max<time_t>(nowTime, _cancelledShutdownTime);
+
+    uint64 nextResetTime = GetNextResetTime(baseTime, day, settings->Time->Hour, settings->Time->Minute, settings->Time->Second);
     uint32 diffToShutdown = nextResetTime - static_cast<uint32>(nowTime);
 
     if (diffToShutdown < 10)
@@ -130,18 +317,43 @@ void ServerAutoShutdown::Init()
         diffToShutdown = nextResetTime - static_cast<uint32>(nowTime);
     }
 
+    // Restart just before a core reset, so the reset is done by the next start on an empty world
+    uint32 alignResetMask = settings->AlignToResetMask;
+    if (alignResetMask)
+    {
+        uint32 leadSeconds = settings->AlignToResetLeadSeconds;
+        time_t earliest = baseTime + 86400 * (day - 1) + leadSeconds + 10;
+
+        if (time_t resetTime = GetNextCoreResetTime(alignResetMask, earliest))
+        {
+            nextResetTime = resetTime - leadSeconds;
+            diffToShutdown = nextResetTime - static_cast<uint32>(nowTime);
+
+            LOG_INFO("module", "> ServerAutoShutdown: Shutdown aligned to the core reset at {}", Acore::Time::TimeToHumanReadable(Seconds(resetTime)));
+        }
+        else
+            LOG_WARN("module", "> ServerAutoShutdown: No core reset found for 'ServerAutoShutdown.AlignToReset.Mask' - {}, use the configured time", alignResetMask);
+    }
+
     LOG_INFO("module", " ");
     LOG_INFO("module","> ServerAutoShutdown: System loading");
 
-    // Cancel all task for support reload config
-    scheduler.CancelAll();
+    // Cancel all shutdown task for support reload config
+    scheduler.CancelGroup(SAS_GROUP_SHUTDOWN);
+    scheduler.CancelGroup(SAS_GROUP_COUNTDOWN);
+
+    _isInitCancel = true;
     sWorld->ShutdownCancel();
+    _isInitCancel = false;
+
+    _scheduledShutdownTime = nextResetTime;
+    _isScheduledRestart = false;
 
     LOG_INFO("module", "> ServerAutoShutdown: Next time to shutdown - {}", Acore::Time::TimeToHumanReadable(Seconds(nextResetTime)));
     LOG_INFO("module", "> ServerAutoShutdown: Remaining time to shutdown - {}", Acore::Time::ToTimeString<Seconds>(diffToShutdown));
     LOG_INFO("module", " ");
 
-    uint32 preAnnounceSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.PreAnnounce.Seconds", 3600);
+    uint32 preAnnounceSeconds = settings->PreAnnounceSeconds;
     if (preAnnounceSeconds > 86400)
     {
         LOG_ERROR("module", "> ServerAutoShutdown: Ahah, how could this happen? Time to preannouce has been set to more than 1 day? ({}). Change to 1 hour (3600)", preAnnounceSeconds);
@@ -159,52 +371,1569 @@ void ServerAutoShutdown::Init()
         preAnnounceSeconds = diffToShutdown;
     }
 
+    ScheduleCountdownTasks(diffToShutdown);
+
     LOG_INFO("module", "> ServerAutoShutdown: Next time to pre annouce - {}", Acore::Time::TimeToHumanReadable(Seconds(timeToPreAnnounce)));
     LOG_INFO("module", "> ServerAutoShutdown: Remaining time to pre annouce - {}", Acore::Time::ToTimeString<Seconds>(diffToPreAnnounce));
     LOG_INFO("module", " ");
 
     StartPersistentGameEvents();
 
-    // Add task for pre shutdown announce
-    scheduler.Schedule(Seconds(diffToPreAnnounce), [preAnnounceSeconds](TaskContext /*context*/)
+    // Background measures, off the world thread
+    uint32 samplerInterval = settings->SamplerInterval;
+    if (samplerInterval)
+    {
+        sSASSampler->Start(samplerInterval);
+        sSASSampler->SetCountersEnabled(settings->CountersEnabled);
+    }
+    else
+        sSASSampler->Stop();
+
+    // Periodic report of the module own cost
+    uint32 costLogInterval = settings->SelfCostLogInterval;
+    if (sSASCost->IsEnabled() && costLogInterval)
+    {
+        scheduler.Schedule(Seconds(costLogInterval), SAS_GROUP_SHUTDOWN, [costLogInterval](TaskContext context)
+        {
+            for (std::string const& line : sSASCost->GetReport())
+                LOG_INFO("module", "> ServerAutoShutdown: Self cost - {}", line);
+
+            context.Repeat(Seconds(costLogInterval));
+        });
+    }
+
+    // Per map degradation, handled by a map unload instead of a full restart
+    uint32 mapHealthInterval = settings->MapHealthInterval;
+    if (mapHealthInterval)
+    {
+        scheduler.Schedule(Seconds(mapHealthInterval), SAS_GROUP_SHUTDOWN, [this, mapHealthInterval](TaskContext context)
+        {
+            CheckMapHealth();
+            context.Repeat(Seconds(mapHealthInterval));
+        });
+    }
+
+    // Latency of the database pools, a pool degraded for two windows asks for a restart
+    uint32 databaseHealthInterval = settings->DatabaseHealthInterval;
+    if (databaseHealthInterval)
+    {
+        scheduler.Schedule(Seconds(databaseHealthInterval), SAS_GROUP_SHUTDOWN, [this, databaseHealthInterval](TaskContext context)
+        {
+            ProbeDatabasePools();
+            context.Repeat(Seconds(databaseHealthInterval));
+        });
+    }
+
+    // New binary or data, restarted in the next quiet window instead of by hand
+    if (settings->DeployEnabled && settings->DeployWindowStart && settings->DeployWindowEnd)
     {
-        std::string preAnnounceMessageFormat = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.PreAnnounce.Message", "[SERVER]: Automated (quick) server restart in %s");
-        std::string message = Acore::StringFormat(preAnnounceMessageFormat, Acore::Time::ToTimeString<Seconds>(preAnnounceSeconds, TimeOutput::Seconds, TimeFormat::FullText));
+        sSASWatcher->Start();
+
+        scheduler.Schedule(Minutes(1), SAS_GROUP_SHUTDOWN, [this](TaskContext context)
+        {
+            CheckDeploy();
+            context.Repeat(Minutes(1));
+        });
+    }
+    else
+        sSASWatcher->Stop();
+
+    // Cheap maintenance on its own schedule, instead of a full restart for everything
+    if (settings->SoftEnabled)
+        ScheduleSoftMaintenance(nowTime);
 
-        LOG_INFO("module", "> {}", message);
+    // Add task for pre shutdown announce, out of the countdown group which a restart on demand replaces
+    scheduler.Schedule(Seconds(diffToPreAnnounce), SAS_GROUP_SHUTDOWN, [this, preAnnounceSeconds](TaskContext /*context*/)
+    {
+        // A restart already on the way (command, health, deploy) keeps its own time
+        if (sWorld->IsShuttingDown())
+            return;
 
-        sWorld->SendServerMessage(SERVER_MSG_STRING, message);
-        sWorld->ShutdownServ(preAnnounceSeconds, SHUTDOWN_MASK_RESTART, SHUTDOWN_EXIT_CODE);
+        _isScheduledRestart = true;
+        RecordTimeline("announce", Acore::StringFormatFmt("\"seconds\":{},\"reason\":\"schedule\"", preAnnounceSeconds));
+        AnnounceRestart(preAnnounceSeconds);
     });
 }
 
-void ServerAutoShutdown::OnUpdate(uint32 diff)
+void ServerAutoShutdown::ScheduleCountdownTasks(uint32 diffToShutdown)
 {
-    // If module disable, why do the update? hah
-    if (!_isEnableModule)
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    scheduler.CancelGroup(SAS_GROUP_COUNTDOWN);
+    _shutdownTime = time(nullptr) + diffToShutdown;
+
+    if (settings->FaultEnabled)
+        ScheduleFaults(diffToShutdown);
+
+    // Profile the degraded world over the last minutes, where it's the worst
+    if (_isHealthRestart && settings->HealthProfileEnabled)
+    {
+        uint32 profileSeconds = settings->HealthProfileSeconds;
+        uint32 diffToProfile = diffToShutdown > profileSeconds ? diffToShutdown - profileSeconds : 1;
+
+        scheduler.Schedule(Seconds(diffToProfile), SAS_GROUP_COUNTDOWN, [this](TaskContext /*context*/)
+        {
+            StartProfile();
+        });
+    }
+
+    // Dump the buffer pool near the end of the countdown, so it's as fresh as possible for the next start
+    if (settings->BufferPoolEnabled)
+    {
+        uint32 dumpBeforeSeconds = settings->BufferPoolDumpBeforeSeconds;
+        uint32 diffToDump = diffToShutdown > dumpBeforeSeconds ? diffToShutdown - dumpBeforeSeconds : 1;
+
+        scheduler.Schedule(Seconds(diffToDump), SAS_GROUP_COUNTDOWN, [this](TaskContext /*context*/)
+        {
+            DumpBufferPool();
+        });
+    }
+
+    // Close the queues, so no group forms only to be dropped by the shutdown
+    OpenContentGate();
+
+    uint32 contentGateSeconds = settings->ContentGateSeconds;
+    if (contentGateSeconds)
+    {
+        uint32 diffToGate = diffToShutdown > contentGateSeconds ? diffToShutdown - contentGateSeconds : 1;
+
+        scheduler.Schedule(Seconds(diffToGate), SAS_GROUP_COUNTDOWN, [this](TaskContext /*context*/)
+        {
+            CloseContentGate();
+        });
+    }
+
+    // Unload idle grids little by little, those of empty instances first, so the final teardown is short
+    _isProgressiveUnload = false;
+    _unloadQueue.clear();
+    _unloadCheckedGrids.clear();
+
+    uint32 unloadSeconds = settings->ProgressiveUnloadSeconds;
+    if (unloadSeconds)
+    {
+        uint32 diffToUnload = diffToShutdown > unloadSeconds ? diffToShutdown - unloadSeconds : 1;
+
+        scheduler.Schedule(Seconds(diffToUnload), SAS_GROUP_COUNTDOWN, [this](TaskContext /*context*/)
+        {
+            StartProgressiveUnload();
+        });
+    }
+
+    // Count the character database writes of the shutdown saves, from a while before the shutdown
+    _isWriteProfiling = false;
+
+    uint32 writeProfileSeconds = settings->WriteProfileSeconds;
+    if (writeProfileSeconds)
+    {
+        uint32 diffToProfile = diffToShutdown > writeProfileSeconds ? diffToShutdown - writeProfileSeconds : 1;
+
+        scheduler.Schedule(Seconds(diffToProfile), SAS_GROUP_COUNTDOWN, [this](TaskContext /*context*/)
+        {
+            _writeProfileStart = GetWriteDigests();
+            _isWriteProfiling = true;
+
+            LOG_INFO("module", "> ServerAutoShutdown: Write profile started ({} statement digests)", _writeProfileStart.size());
+        });
+    }
+
+    // Rotate the logs before the shutdown, the compression runs while the next server starts
+    uint32 logRotateSeconds = settings->LogRotateSeconds;
+    if (logRotateSeconds)
+    {
+        uint32 diffToRotate = diffToShutdown > logRotateSeconds ? diffToShutdown - logRotateSeconds : 1;
+
+        scheduler.Schedule(Seconds(diffToRotate), SAS_GROUP_COUNTDOWN, [this](TaskContext /*context*/)
+        {
+            RotateLogs();
+        });
+    }
+
+    // Mark the realm offline at the end of the countdown, clients stop trying to log in
+    if (settings->RealmStatusEnabled)
+    {
+        uint32 offlineSeconds = settings->RealmStatusOfflineSeconds;
+        uint32 diffToOffline = diffToShutdown > offlineSeconds ? diffToShutdown - offlineSeconds : 1;
+
+        scheduler.Schedule(Seconds(diffToOffline), SAS_GROUP_COUNTDOWN, [this](TaskContext /*context*/)
+        {
+            SetRealmOffline(true);
+        });
+    }
+
+    // Only a few realms of the database cluster in their save and startup phase at once
+    if (settings->LeaseEnabled)
+    {
+        uint32 diffToLease = diffToShutdown > settings->LeaseBeforeSeconds ? diffToShutdown - settings->LeaseBeforeSeconds : 1;
+
+        scheduler.Schedule(Seconds(diffToLease), SAS_GROUP_COUNTDOWN, [this, waitedSeconds = uint32(0)](TaskContext context) mutable
+        {
+            std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+            // Only for the last seconds of a shutdown on the way, whoever set its timer. A pre-announce
+            // shorter than the lease lead starts the timer after this task, it's waited for
+            if (!sWorld->IsShuttingDown())
+            {
+                context.Repeat(Seconds(1));
+                return;
+            }
+
+            uint32 timeLeft = sWorld->GetShutDownTimeLeft();
+            if (!waitedSeconds && timeLeft > settings->LeaseBeforeSeconds + 1)
+            {
+                context.Repeat(Seconds(timeLeft - settings->LeaseBeforeSeconds));
+                return;
+            }
+
+            if (AcquireRestartLease())
+            {
+                LOG_INFO("module", "> ServerAutoShutdown: Restart lease taken after {} s", waitedSeconds);
+                RecordTimeline("lease", Acore::StringFormatFmt("\"waited_s\":{}", waitedSeconds));
+                ScheduleLeaseHeartbeat(SAS_GROUP_COUNTDOWN);
+                return;
+            }
+
+            if (waitedSeconds >= settings->LeaseMaxWaitSeconds)
+            {
+                LOG_WARN("module", "> ServerAutoShutdown: No restart lease after {} s, restart without it", waitedSeconds);
+                return;
+            }
+
+            uint32 retrySeconds = settings->LeaseHeartbeatSeconds;
+            waitedSeconds += retrySeconds;
+
+            LOG_INFO("module", "> ServerAutoShutdown: All {} restart leases are taken, shutdown delayed by {} s", settings->LeaseSlots, retrySeconds);
+            DelayCountdown(retrySeconds);
+            context.Repeat(Seconds(retrySeconds));
+        });
+    }
+}
+
+void ServerAutoShutdown::DelayCountdown(uint32 seconds)
+{
+    _shutdownTime += seconds;
+    scheduler.DelayGroup(SAS_GROUP_COUNTDOWN, Seconds(seconds));
+
+    // The watchdog follows the world timer
+    if (sWorld->IsShuttingDown())
+        sWorld->ShutdownServ(static_cast<uint32>(_shutdownTime - time(nullptr)), SHUTDOWN_MASK_RESTART, SHUTDOWN_EXIT_CODE);
+}
+
+bool ServerAutoShutdown::AcquireRestartLease()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+    std::string const& table = settings->LeaseTable;
+
+    // Leases of realms which never came back
+    DatabaseQuery(settings->LeaseDatabase, Acore::StringFormatFmt("DELETE FROM {} WHERE expire_time < UNIX_TIMESTAMP()", table), true);
+
+    // Every free slot is tried, the unique realm id keeps the realm in one of them at most. The expiry
+    // is on the database clock, the one the leases are expired by, realms on other hosts may drift
+    std::string values;
+    for (uint32 slot = 0; slot < settings->LeaseSlots; ++slot)
+        values += Acore::StringFormatFmt("{}({}, {}, {}, UNIX_TIMESTAMP() + {})", slot ? ", " : "", slot, realm.Id.Realm, GetPID(), settings->LeaseSeconds);
+
+    DatabaseQuery(settings->LeaseDatabase, Acore::StringFormatFmt("INSERT IGNORE INTO {} (slot, realm_id, pid, expire_time) VALUES {}", table, values), true);
+
+    if (!DatabaseQuery(settings->LeaseDatabase, Acore::StringFormatFmt("SELECT slot FROM {} WHERE realm_id = {}", table, realm.Id.Realm)))
+        return false;
+
+    _hasRestartLease = true;
+    return true;
+}
+
+void ServerAutoShutdown::ScheduleLeaseHeartbeat(SASTaskGroup group)
+{
+    scheduler.Schedule(Seconds(ServerAutoShutdownSettings::Get()->LeaseHeartbeatSeconds), group, [this](TaskContext context)
+    {
+        // Released (logins open, shutdown cancelled), the heartbeat ends with it
+        if (!_hasRestartLease)
+            return;
+
+        std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+        DatabaseQuery(settings->LeaseDatabase, Acore::StringFormatFmt("UPDATE {} SET expire_time = UNIX_TIMESTAMP() + {} WHERE realm_id = {}",
+            settings->LeaseTable, settings->LeaseSeconds, realm.Id.Realm), true);
+
+        context.Repeat(Seconds(settings->LeaseHeartbeatSeconds));
+    });
+}
+
+void ServerAutoShutdown::ReleaseRestartLease()
+{
+    if (!_hasRestartLease)
         return;
 
-    scheduler.Update(diff);
+    _hasRestartLease = false;
+
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+    DatabaseQuery(settings->LeaseDatabase, Acore::StringFormatFmt("DELETE FROM {} WHERE realm_id = {}", settings->LeaseTable, realm.Id.Realm), true);
+
+    LOG_INFO("module", "> ServerAutoShutdown: Restart lease released");
 }
 
-void ServerAutoShutdown::StartPersistentGameEvents()
+void ServerAutoShutdown::SetReady()
 {
-    std::string eventList = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.StartEvents", "");
+    RecordTimeline("ready");
+    ReleaseRestartLease();
+}
 
-    std::vector<std::string_view> tokens = Acore::Tokenize(eventList, ' ', false);
-    GameEventMgr::GameEventDataMap const& events = sGameEventMgr->GetEventMap();
+void ServerAutoShutdown::ScheduleFaults(uint32 diffToShutdown)
+{
+    uint32 windowSeconds = ServerAutoShutdownSettings::Get()->FaultWindowSeconds;
+    uint32 diffToWindow = diffToShutdown > windowSeconds ? diffToShutdown - windowSeconds : 1;
 
-    for (auto token : tokens)
+    LOG_WARN("module", "> ServerAutoShutdown: Fault injection enabled, faults start {} before the shutdown", Acore::Time::ToTimeString<Seconds>(windowSeconds));
+
+    // Rolled every second until the shutdown
+    scheduler.Schedule(Seconds(diffToWindow), SAS_GROUP_COUNTDOWN, [](TaskContext context)
     {
-        if (token.empty())
+        std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+        // Slow commits, the player saves queue behind them
+        if (roll_chance_f(settings->FaultSlowCommitChance))
         {
-            continue;
+            uint32 milliseconds = settings->FaultSlowCommitMilliseconds;
+            CharacterDatabase.Execute("DO SLEEP({:.3f})", milliseconds / 1000.0f);
         }
 
-        uint32 eventId = *Acore::StringTo<uint32>(token);
-        sGameEventMgr->StartEvent(eventId);
+        // Stuck world update, sessions are neither updated nor kicked meanwhile
+        if (roll_chance_f(settings->FaultStallChance))
+            std::this_thread::sleep_for(Milliseconds(settings->FaultStallMilliseconds));
 
-        GameEventData const& eventData = events[eventId];
-        LOG_INFO("module", "> ServerAutoShutdown: Starting event {} ({}).", eventData.description, eventId);
+        context.Repeat(Seconds(1));
+    });
+}
+
+void ServerAutoShutdown::UpdateWatchdog()
+{
+    uint32 watchdogSeconds = ServerAutoShutdownSettings::Get()->WatchdogSeconds;
+
+    // Last resort bound of the downtime, from the world shutdown timer whoever started or moved it
+    if (!watchdogSeconds || !sWorld->IsShuttingDown())
+    {
+        DisarmWatchdog();
+        return;
+    }
+
+    StartWatchdog();
+    watchdogDeadline = time(nullptr) + sWorld->GetShutDownTimeLeft() + watchdogSeconds;
+}
+
+void ServerAutoShutdown::DisarmWatchdog()
+{
+    watchdogDeadline = 0;
+}
+
+void ServerAutoShutdown::RecordTimeline(std::string_view event, std::string_view extra /*= {}*/)
+{
+    WriteTimeline(event, extra);
+}
+
+void ServerAutoShutdown::StartRestart(uint32 seconds, std::string_view reason)
+{
+    _isScheduledRestart = false;
+    RecordTimeline("announce", Acore::StringFormatFmt("\"seconds\":{},\"reason\":\"{}\"", seconds, reason));
+
+    ScheduleCountdownTasks(seconds);
+    AnnounceRestart(seconds);
+}
+
+void ServerAutoShutdown::AnnounceRestart(uint32 seconds)
+{
+    SASCostScope costScope(SAS_COST_ANNOUNCE);
+
+    std::string preAnnounceMessageFormat = ServerAutoShutdownSettings::Get()->PreAnnounceMessage;
+    std::string message = Acore::StringFormat(preAnnounceMessageFormat, Acore::Time::ToTimeString<Seconds>(seconds, TimeOutput::Seconds, TimeFormat::FullText));
+
+    LOG_INFO("module", "> {}", message);
+
+    sWorld->SendServerMessage(SERVER_MSG_STRING, message);
+    sWorld->ShutdownServ(seconds, SHUTDOWN_MASK_RESTART, SHUTDOWN_EXIT_CODE);
+}
+
+void ServerAutoShutdown::RequestRestart(std::string_view reason)
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    if (!_isEnableModule || sWorld->IsShuttingDown())
+        return;
+
+    if (!settings->HealthAllowRestart)
+    {
+        LOG_WARN("module", "> ServerAutoShutdown: Restart wanted ({}), but 'ServerAutoShutdown.Health.AllowRestart' is disabled", reason);
+        return;
     }
+
+    LOG_WARN("module", "> ServerAutoShutdown: Restart before the schedule - {}", reason);
+
+    // Image of the degraded process for offline analysis, the world only waits for the fork
+    if (settings->HealthDumpEnabled)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        uint32 dumper = ServerAutoShutdownDump::ForkCore(settings->HealthDumpDirectory, settings->HealthDumpFilter);
+        auto forkMs = std::chrono::duration_cast<Milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+
+        if (dumper)
+        {
+            LOG_INFO("module", "> ServerAutoShutdown: Core dump being written by process {}, fork took {} ms", dumper, forkMs);
+            RecordTimeline("dump", Acore::StringFormatFmt("\"dumper_pid\":{},\"fork_ms\":{}", dumper, forkMs));
+
+            // Not left as a zombie while the server runs, init takes it over once the server is gone
+            scheduler.Schedule(Seconds(5), SAS_GROUP_CHILD, [dumper](TaskContext context)
+            {
+                if (!ServerAutoShutdownDump::Reap(dumper))
+                    context.Repeat(Seconds(5));
+            });
+        }
+    }
+
+    _isHealthRestart = true;
+    StartRestart(std::min<uint32>(settings->PreAnnounceSeconds, 86400), reason);
+}
+
+void ServerAutoShutdown::StartProfile()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    std::filesystem::path path(settings->HealthProfileDirectory);
+    path /= Acore::StringFormatFmt("worldserver_{}_{}.folded", GetPID(), time(nullptr));
+
+    std::vector<std::string> threadNames;
+    for (auto const& name : Acore::Tokenize(settings->HealthProfileThreads, ' ', false))
+        threadNames.emplace_back(name);
+
+    // Running until the shutdown, or for the seconds if the restart is delayed
+    if (sSASProfiler->Start(threadNames, settings->HealthProfileFrequency, settings->HealthProfileSeconds, path.string()))
+        RecordTimeline("profile", Acore::StringFormatFmt("\"file\":\"{}\"", path.generic_string()));
+}
+
+void ServerAutoShutdown::StopProfile()
+{
+    sSASProfiler->Stop();
+}
+
+void ServerAutoShutdown::CheckDeploy()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    if (Optional<std::string> deploy = sSASWatcher->TakeDeploy())
+    {
+        LOG_INFO("module", "> ServerAutoShutdown: {} complete, restart in the next window", *deploy);
+        _pendingDeploy = std::move(*deploy);
+    }
+
+    // A restart already on the way applies the deploy as well
+    if (_pendingDeploy.empty() || sWorld->IsShuttingDown())
+        return;
+
+    tm localTime = Acore::Time::TimeBreakdown(time(nullptr));
+    uint32 daySeconds = localTime.tm_hour * HOUR + localTime.tm_min * MINUTE + localTime.tm_sec;
+
+    uint32 windowStart = settings->DeployWindowStart->GetDaySeconds();
+    uint32 windowEnd = settings->DeployWindowEnd->GetDaySeconds();
+
+    // The window can cross midnight
+    bool isInWindow = windowStart <= windowEnd ?
+        daySeconds >= windowStart && daySeconds < windowEnd :
+        daySeconds >= windowStart || daySeconds < windowEnd;
+
+    if (!isInWindow || sWorld->GetPlayerCount() > settings->DeployMaxPlayers)
+        return;
+
+    StartRestart(std::min<uint32>(settings->PreAnnounceSeconds, 86400), _pendingDeploy);
+    _pendingDeploy.clear();
+}
+
+void ServerAutoShutdown::ReportHealth(std::string reason)
+{
+    std::lock_guard<std::mutex> lock(_healthReportsLock);
+    _healthReports.emplace_back(std::move(reason));
+}
+
+void ServerAutoShutdown::ScheduleSoftMaintenance(time_t nowTime)
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    uint32 day = settings->SoftEveryDays;
+
+    if (!settings->SoftTime)
+        return;
+
+    if (day < 1 || day > 365)
+    {
+        LOG_ERROR("module", "> ServerAutoShutdown: Incorrect day in config option 'ServerAutoShutdown.Soft.EveryDays' - '{}'", day);
+        return;
+    }
+
+    time_t nextSoftTime = GetNextResetTime(nowTime, day, settings->SoftTime->Hour, settings->SoftTime->Minute, settings->SoftTime->Second);
+    if (nextSoftTime - nowTime < 10)
+        nextSoftTime += 86400 * day;
+
+    uint32 diffToSoft = static_cast<uint32>(nextSoftTime - nowTime);
+    uint32 announceSeconds = std::min<uint32>(settings->SoftPreAnnounceSeconds, diffToSoft - 1);
+
+    LOG_INFO("module", "> ServerAutoShutdown: Next soft maintenance - {}", Acore::Time::TimeToHumanReadable(Seconds(nextSoftTime)));
+    LOG_INFO("module", " ");
+
+    if (announceSeconds)
+    {
+        scheduler.Schedule(Seconds(diffToSoft - announceSeconds), SAS_GROUP_SHUTDOWN, [day, announceSeconds](TaskContext context)
+        {
+            if (!sWorld->IsShuttingDown())
+            {
+                std::string messageFormat = ServerAutoShutdownSettings::Get()->SoftPreAnnounceMessage;
+                sWorld->SendServerMessage(SERVER_MSG_STRING, Acore::StringFormat(messageFormat, Acore::Time::ToTimeString<Seconds>(announceSeconds, TimeOutput::Seconds, TimeFormat::FullText)));
+            }
+
+            context.Repeat(Seconds(86400 * day));
+        });
+    }
+
+    scheduler.Schedule(Seconds(diffToSoft), SAS_GROUP_SHUTDOWN, [this, day](TaskContext context)
+    {
+        // The restart does it all anyway
+        if (!sWorld->IsShuttingDown())
+            RunSoftMaintenance();
+
+        context.Repeat(Seconds(86400 * day));
+    });
+}
+
+void ServerAutoShutdown::RunSoftMaintenance()
+{
+    uint32 actions = ServerAutoShutdownSettings::Get()->SoftActions;
+    auto startTime = std::chrono::steady_clock::now();
+
+    LOG_INFO("module", "> ServerAutoShutdown: Soft maintenance started (actions {})", actions);
+
+    if (actions & SAS_SOFT_UNLOAD_GRIDS)
+    {
+        uint32 unloaded = 0;
+        sMapMgr->DoForAllMaps([this, &unloaded](Map* map)
+        {
+            unloaded += UnloadIdleGrids(map);
+        });
+
+        LOG_INFO("module", "> ServerAutoShutdown: Soft maintenance - {} idle grids unloaded", unloaded);
+    }
+
+    if (actions & SAS_SOFT_DATABASE_PING)
+    {
+        for (uint8 i = 0; i < MAX_SAS_DATABASE_POOLS; ++i)
+            PingDatabasePool(static_cast<SASDatabasePool>(i));
+    }
+
+    // Last, after the unloads freed their memory
+    if (actions & SAS_SOFT_ALLOCATOR_PURGE)
+        ServerAutoShutdownAllocator::Purge();
+
+    LOG_INFO("module", "> ServerAutoShutdown: Soft maintenance done in {} ms",
+        std::chrono::duration_cast<Milliseconds>(std::chrono::steady_clock::now() - startTime).count());
+}
+
+void ServerAutoShutdown::OnStartup()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    // Cold start cost, everything between the process start and the world being ready
+    _startupSeconds = static_cast<uint32>(time(nullptr) - GameTime::GetStartTime().count());
+
+    // Before players, so the whole uptime runs with it
+    ServerAutoShutdownAllocator::ApplyProfile();
+
+    timelineFile = settings->TimelineFile;
+    if (!timelineFile.empty())
+    {
+        RecordTimeline("start", Acore::StringFormatFmt("\"start_ms\":{}", uint64(GameTime::GetStartTime().count()) * 1000));
+        RecordTimeline("startup");
+
+        // After everything, the databases are closed and the process ends
+        std::atexit([]
+        {
+            WriteTimeline("exit", {});
+        });
+    }
+
+    Init();
+
+    if (!_isEnableModule)
+        return;
+
+    LOG_INFO("module", "> ServerAutoShutdown: Server start took {}", Acore::Time::ToTimeString<Seconds>(_startupSeconds));
+
+    if (settings->BufferPoolEnabled)
+        StartBufferPoolLoad();
+
+    std::string checkpointMarker = settings->CheckpointMarkerFile;
+    if (!checkpointMarker.empty())
+        WriteCheckpointMarker(checkpointMarker);
+
+    // Veto which is never released
+    if (settings->FaultEnabled && roll_chance_f(settings->FaultVetoChance))
+        HoldAdmission("fault injection veto");
+
+    uint32 maxHoldSeconds = settings->AdmissionMaxHoldSeconds;
+    if (_admissionHolds && maxHoldSeconds)
+    {
+        scheduler.Schedule(Seconds(maxHoldSeconds), SAS_GROUP_STARTUP, [this](TaskContext /*context*/)
+        {
+            if (!_admissionHolds)
+                return;
+
+            LOG_WARN("module", "> ServerAutoShutdown: {} player logins holds not released in time, forced release", _admissionHolds);
+
+            _admissionHolds = 1;
+            ReleaseAdmission("hold timeout");
+        });
+    }
+
+    // The lease of the restart which started this process, kept until logins open. A start by hand
+    // or after a restart without lease has none
+    if (settings->LeaseEnabled && DatabaseQuery(settings->LeaseDatabase, Acore::StringFormatFmt("SELECT slot FROM {} WHERE realm_id = {}", settings->LeaseTable, realm.Id.Realm)))
+    {
+        _hasRestartLease = true;
+        ScheduleLeaseHeartbeat(SAS_GROUP_STARTUP);
+    }
+
+    if (!_admissionHolds)
+        SetReady();
+}
+
+void ServerAutoShutdown::OnShutdown()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    RecordTimeline("expiry", Acore::StringFormatFmt("\"planned_ms\":{},\"health\":{}", uint64(_shutdownTime) * 1000, _isHealthRestart));
+
+    StopProfile();
+    sSASSampler->Stop();
+    sSASWatcher->Stop();
+
+    if (_isWriteProfiling)
+    {
+        // The core logs the players out after this hook, here it's done first so their saves are measured
+        sWorld->KickAll();
+        sWorld->UpdateSessions(1);
+
+        if (!WaitForCharacterWrites(Seconds(60)))
+            LOG_WARN("module", "> ServerAutoShutdown: Character database writes still queued after 60 s, the write profile misses them");
+
+        WriteShutdownWriteProfile();
+    }
+
+    // Stopped above and written on its own thread meanwhile, the process must not exit before it's done
+    sSASProfiler->Wait();
+
+    // Hung teardown, after the world stopped
+    if (settings->FaultEnabled && roll_chance_f(settings->FaultHungTeardownChance))
+    {
+        uint32 hungSeconds = settings->FaultHungTeardownSeconds;
+        LOG_WARN("module", "> ServerAutoShutdown: Fault injection - teardown hung for {}", Acore::Time::ToTimeString<Seconds>(hungSeconds));
+        std::this_thread::sleep_for(Seconds(hungSeconds));
+    }
+}
+
+void ServerAutoShutdown::OnShutdownCancel()
+{
+    // Every task of the cancelled restart, none of them may run on a world which keeps going
+    scheduler.CancelGroup(SAS_GROUP_COUNTDOWN);
+
+    OpenContentGate();
+    SetRealmOffline(false);
+    DisarmWatchdog();
+    ReleaseRestartLease();
+    StopProfile();
+
+    // The pass tasks are gone with the group, the pass under way stops here
+    _isProgressiveUnload = false;
+    _unloadQueue.clear();
+    _unloadCheckedGrids.clear();
+
+    // A reload cancels the world shutdown from the init itself
+    if (_isInitCancel)
+        return;
+
+    if (_isScheduledRestart)
+        _cancelledShutdownTime = _scheduledShutdownTime;
+
+    _isHealthRestart = false;
+
+    // The daily restart was replaced by the cancelled one, or is the cancelled one
+    Init();
+}
+
+void ServerAutoShutdown::OnUpdate(uint32 diff)
+{
+    // Callbacks of queries already sent, the save benchmark runs with the module disabled too
+    queryProcessor.ProcessReadyCallbacks();
+    transactionProcessor.ProcessReadyCallbacks();
+
+    // If module disable, why do the update? hah
+    if (!_isEnableModule)
+        return;
+
+    SASCostScope costScope(SAS_COST_UPDATE);
+    scheduler.Update(diff);
+    UpdateWatchdog();
+
+    if (_isProgressiveUnload)
+        UpdateProgressiveUnload();
+
+    std::vector<std::string> healthReports;
+    {
+        std::lock_guard<std::mutex> lock(_healthReportsLock);
+        healthReports.swap(_healthReports);
+    }
+
+    for (std::string const& reason : healthReports)
+        RequestRestart(reason);
+}
+
+void ServerAutoShutdown::StartPersistentGameEvents()
+{
+    std::string eventList = ServerAutoShutdownSettings::Get()->StartEvents;
+
+    std::vector<std::string_view> tokens = Acore::Tokenize(eventList, ' ', false);
+    GameEventMgr::GameEventDataMap const& events = sGameEventMgr->GetEventMap();
+
+    for (auto token : tokens)
+    {
+        if (token.empty())
+        {
+            continue;
+        }
+
+        uint32 eventId = *Acore::StringTo<uint32>(token);
+
+        // Init runs again after a cancel or reload, the spawns of a running event are there already
+        if (sGameEventMgr->IsActiveEvent(eventId))
+            continue;
+
+        sGameEventMgr->StartEvent(eventId);
+
+        GameEventData const& eventData = events[eventId];
+        LOG_INFO("module", "> ServerAutoShutdown: Starting event {} ({}).", eventData.description, eventId);
+    }
+}
+
+void ServerAutoShutdown::HoldAdmission(std::string_view reason)
+{
+    if (!_admissionHolds++)
+    {
+        _savedSecurityLimit = sWorld->GetPlayerSecurityLimit();
+
+        if (_savedSecurityLimit < SEC_GAMEMASTER)
+            sWorld->SetPlayerSecurityLimit(SEC_GAMEMASTER);
+
+        // The core set the realm online at start, it's not ready yet
+        if (ServerAutoShutdownSettings::Get()->RealmStatusEnabled)
+            SetRealmOffline(true);
+    }
+
+    LOG_INFO("module", "> ServerAutoShutdown: Holding player logins - {}", reason);
+}
+
+void ServerAutoShutdown::ReleaseAdmission(std::string_view reason)
+{
+    if (!_admissionHolds)
+        return;
+
+    LOG_INFO("module", "> ServerAutoShutdown: Release player logins hold - {}", reason);
+
+    if (!--_admissionHolds)
+    {
+        sWorld->SetPlayerSecurityLimit(_savedSecurityLimit);
+        SetRealmOffline(false);
+        SetReady();
+    }
+}
+
+void ServerAutoShutdown::SetRealmOffline(bool offline)
+{
+    if (_isRealmOffline == offline)
+        return;
+
+    _isRealmOffline = offline;
+
+    if (offline)
+        LoginDatabase.Execute("UPDATE realmlist SET flag = flag | {}, population = 0 WHERE id = {}", REALM_FLAG_OFFLINE, realm.Id.Realm);
+    else
+        LoginDatabase.Execute("UPDATE realmlist SET flag = flag & ~{} WHERE id = {}", REALM_FLAG_OFFLINE, realm.Id.Realm);
+
+    LOG_INFO("module", "> ServerAutoShutdown: Realm {} marked {} in the realm list", realm.Id.Realm, offline ? "offline" : "online");
+}
+
+void ServerAutoShutdown::DumpBufferPool()
+{
+    LOG_INFO("module", "> ServerAutoShutdown: Dumping InnoDB buffer pool for the next start");
+    BufferPoolQuery("SET GLOBAL innodb_buffer_pool_dump_now = ON", true);
+}
+
+void ServerAutoShutdown::StartBufferPoolLoad()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    std::string status;
+    float progress = GetBufferPoolLoadProgress(status);
+
+    if (progress < 0.0f)
+    {
+        LOG_WARN("module", "> ServerAutoShutdown: Can't read InnoDB buffer pool load status, skip warm up");
+        return;
+    }
+
+    // The server may already load it by itself (innodb_buffer_pool_load_at_startup), then the status is
+    // "Loading buffer pool(s) from <file>". Idle it's "Loading of buffer pool not started" or an aborted load
+    if (progress == 0.0f && status.rfind("Loading buffer pool(s) from", 0) == std::string::npos)
+    {
+        LOG_INFO("module", "> ServerAutoShutdown: Start loading InnoDB buffer pool ({})", status);
+        BufferPoolQuery("SET GLOBAL innodb_buffer_pool_load_now = ON", true);
+    }
+
+    float holdFraction = settings->BufferPoolHoldFraction;
+    uint32 holdTimeout = settings->BufferPoolHoldTimeout;
+    uint32 pollSeconds = settings->BufferPoolPollSeconds;
+
+    bool hold = holdFraction > 0.0f && progress < holdFraction;
+    if (hold)
+        HoldAdmission("InnoDB buffer pool warm up");
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    scheduler.Schedule(Seconds(pollSeconds), SAS_GROUP_STARTUP, [this, hold, holdFraction, holdTimeout, pollSeconds, startTime](TaskContext context) mutable
+    {
+        std::string status;
+        float progress = GetBufferPoolLoadProgress(status);
+        Seconds elapsed = std::chrono::duration_cast<Seconds>(std::chrono::steady_clock::now() - startTime);
+
+        bool finished = progress < 0.0f || progress >= 1.0f || status.find("aborted") != std::string::npos;
+
+        if (hold && (finished || progress >= holdFraction || elapsed >= Seconds(holdTimeout)))
+        {
+            if (progress < holdFraction && !finished)
+                LOG_WARN("module", "> ServerAutoShutdown: InnoDB buffer pool warm up timeout at {:.0f}%", progress * 100.0f);
+
+            ReleaseAdmission("InnoDB buffer pool warm up");
+            hold = false;
+        }
+
+        if (finished)
+        {
+            LOG_INFO("module", "> ServerAutoShutdown: InnoDB buffer pool load finished in {} ({})", Acore::Time::ToTimeString<Seconds>(elapsed.count()), status);
+            return;
+        }
+
+        LOG_DEBUG("module", "> ServerAutoShutdown: InnoDB buffer pool load at {:.0f}%", progress * 100.0f);
+        context.Repeat(Seconds(pollSeconds));
+    });
+}
+
+float ServerAutoShutdown::GetBufferPoolLoadProgress(std::string& status)
+{
+    QueryResult result = BufferPoolQuery("SHOW GLOBAL STATUS LIKE 'Innodb_buffer_pool_load_status'");
+    if (!result)
+        return -1.0f;
+
+    status = result->Fetch()[1].Get<std::string>();
+
+    // "Buffer pool(s) load completed at 230101 04:05:00"
+    if (status.find("completed") != std::string::npos)
+        return 1.0f;
+
+    // "Loaded 5121/65536 pages"
+    std::size_t loadedPos = status.find("Loaded ");
+    std::size_t slashPos = status.find('/');
+    if (loadedPos == std::string::npos || slashPos == std::string::npos)
+        return 0.0f;
+
+    auto loaded = Acore::StringTo<uint64>(status.substr(loadedPos + 7, slashPos - loadedPos - 7));
+    auto total = Acore::StringTo<uint64>(status.substr(slashPos + 1, status.find(' ', slashPos) - slashPos - 1));
+    if (!loaded || !total || !*total)
+        return 0.0f;
+
+    return std::min(1.0f, float(*loaded) / float(*total));
+}
+
+void ServerAutoShutdown::WriteCheckpointMarker(std::string const& path)
+{
+    std::error_code error;
+    std::string binaryPath = std::filesystem::read_symlink("/proc/self/exe", error).string();
+    if (error)
+    {
+        LOG_ERROR("module", "> ServerAutoShutdown: Can't find the server binary for the checkpoint marker ({})", error.message());
+        return;
+    }
+
+    std::string configPath = sConfigMgr->GetFilename();
+
+    // Content of the world database, updated by every world db update
+    std::string worldVersion;
+    if (QueryResult result = WorldDatabase.Query("SELECT db_version, cache_id FROM version LIMIT 1"))
+        worldVersion = Acore::StringFormatFmt("{}:{}", result->Fetch()[0].Get<std::string>(), result->Fetch()[1].Get<uint32>());
+
+    // Written to a temporary file and renamed, the helper never sees a partial marker
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream marker(tempPath, std::ios::trunc);
+        if (!marker)
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: Can't write checkpoint marker '{}'", tempPath);
+            return;
+        }
+
+        marker << "pid=" << GetPID() << '\n';
+        marker << "binary=" << binaryPath << '\n';
+        marker << "binary_hash=" << Acore::StringFormatFmt("{:016x}", ServerAutoShutdownWatcher::GetFileHash(binaryPath)) << '\n';
+        marker << "config=" << configPath << '\n';
+        marker << "config_hash=" << Acore::StringFormatFmt("{:016x}", ServerAutoShutdownWatcher::GetFileHash(configPath)) << '\n';
+        marker << "world_db=" << worldVersion << '\n';
+        marker << "time=" << time(nullptr) << '\n';
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        LOG_ERROR("module", "> ServerAutoShutdown: Can't write checkpoint marker '{}' ({})", path, error.message());
+        return;
+    }
+
+    LOG_INFO("module", "> ServerAutoShutdown: Startup is quiescent, checkpoint marker written to '{}'", path);
+
+    uint32 holdSeconds = ServerAutoShutdownSettings::Get()->CheckpointHoldSeconds;
+    if (!holdSeconds)
+        return;
+
+    // The checkpoint helper removes the marker when it's done with the process
+    HoldAdmission("checkpoint");
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    scheduler.Schedule(Seconds(1), SAS_GROUP_STARTUP, [this, path, holdSeconds, startTime](TaskContext context)
+    {
+        std::error_code error;
+        if (std::filesystem::exists(path, error) && std::chrono::steady_clock::now() - startTime < Seconds(holdSeconds))
+        {
+            context.Repeat(Seconds(1));
+            return;
+        }
+
+        if (std::filesystem::exists(path, error))
+            LOG_WARN("module", "> ServerAutoShutdown: Checkpoint marker '{}' still exists after {} seconds", path, holdSeconds);
+
+        ReleaseAdmission("checkpoint");
+    });
+}
+
+std::vector<SASMapHealthInfo> ServerAutoShutdown::GetMapHealth() const
+{
+    std::vector<SASMapHealthInfo> maps;
+    maps.reserve(_mapHealth.size());
+
+    for (auto const& [key, info] : _mapHealth)
+        maps.emplace_back(info);
+
+    std::sort(maps.begin(), maps.end(), [](SASMapHealthInfo const& left, SASMapHealthInfo const& right)
+    {
+        return left.Objects > right.Objects;
+    });
+
+    return maps;
+}
+
+uint32 ServerAutoShutdown::UnloadIdleGrids(Map* map, std::chrono::steady_clock::time_point deadline, std::unordered_set<uint32>* checked)
+{
+    uint32 unloaded = 0;
+
+    for (GridRefMgr<NGridType>::iterator itr = map->GridRefMgr<NGridType>::begin(); itr != map->GridRefMgr<NGridType>::end();)
+    {
+        NGridType& grid = *itr->GetSource();
+        ++itr;
+
+        // Cheap to skip, the refused grids of a busy map alone can take longer than the budget
+        if (checked && !checked->insert(grid.GetGridId()).second)
+            continue;
+
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            if (checked)
+                checked->erase(grid.GetGridId());
+
+            break;
+        }
+
+        // Refuse grids with players, pets or active objects around
+        if (map->UnloadGrid(grid, false))
+            ++unloaded;
+    }
+
+    return unloaded;
+}
+
+void ServerAutoShutdown::RotateLogs()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    namespace fs = std::filesystem;
+
+    fs::path logsDir = sConfigMgr->GetOption<std::string>("LogsDir", "");
+    std::string suffix = Acore::Time::TimeToTimestampStr(Seconds(time(nullptr)), "%Y%m%d-%H%M%S");
+    std::vector<std::string> rotated;
+    std::error_code error;
+
+    // Appender.Name = Type,LogLevel,Flags,File,Mode - only file appenders (type 2) with a fixed name
+    for (std::string const& key : sConfigMgr->GetKeysByString("Appender."))
+    {
+        std::string options = sConfigMgr->GetOption<std::string>(key, "");
+        auto const& tokens = Acore::Tokenize(options, ',', true);
+
+        if (tokens.size() < 4 || tokens[0] != "2" || tokens[3].find("%s") != std::string_view::npos)
+            continue;
+
+        fs::path file = logsDir / std::string(tokens[3]);
+        fs::path target = file.string() + "." + suffix;
+
+        if (!fs::exists(file, error))
+            continue;
+
+        fs::rename(file, target, error);
+        if (error)
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: Can't rotate log '{}' ({})", file.string(), error.message());
+            continue;
+        }
+
+        rotated.emplace_back(target.string());
+
+        // Drop the oldest rotated logs of this appender above the size limit
+        uint64 maxSize = uint64(settings->LogRotateMaxSizeMB) * 1024 * 1024;
+        if (!maxSize)
+            continue;
+
+        std::vector<fs::directory_entry> history;
+        for (auto const& entry : fs::directory_iterator(file.parent_path(), error))
+            if (entry.is_regular_file(error) && entry.path().filename().string().rfind(file.filename().string() + ".", 0) == 0)
+                history.emplace_back(entry);
+
+        std::sort(history.begin(), history.end(), [](fs::directory_entry const& left, fs::directory_entry const& right)
+        {
+            return left.path().filename() > right.path().filename();
+        });
+
+        uint64 size = 0;
+        for (auto const& entry : history)
+        {
+            size += entry.file_size(error);
+            if (size > maxSize && entry.path() != target)
+                fs::remove(entry.path(), error);
+        }
+    }
+
+    // Open new files for all appenders
+    sLog->LoadFromConfig();
+
+    LOG_INFO("module", "> ServerAutoShutdown: Rotated {} log files", rotated.size());
+
+    std::string compressor = settings->LogRotateCompressor;
+    if (rotated.empty() || compressor.empty())
+        return;
+
+#if AC_PLATFORM == AC_PLATFORM_WINDOWS
+    LOG_WARN("module", "> ServerAutoShutdown: Log compression is not supported on Windows");
+#else
+    // Detached and at the lowest priority, nobody waits on it
+    std::string command = "(";
+    for (std::string const& file : rotated)
+        command += Acore::StringFormatFmt(" nice -n 19 ionice -c 3 {} {};", compressor, ShellQuote(file));
+    command += " ) >/dev/null 2>&1 &";
+
+    if (std::system(command.c_str()))
+        LOG_ERROR("module", "> ServerAutoShutdown: Can't start log compression '{}'", compressor);
+#endif
+}
+
+std::map<std::string, SASWriteDigestStats> ServerAutoShutdown::GetWriteDigests()
+{
+    std::map<std::string, SASWriteDigestStats> digests;
+
+    QueryResult result = CharacterDatabase.Query("SELECT DIGEST, DIGEST_TEXT, COUNT_STAR, SUM_ROWS_AFFECTED, SUM_TIMER_WAIT, MAX_TIMER_WAIT "
+        "FROM performance_schema.events_statements_summary_by_digest WHERE SCHEMA_NAME = DATABASE() AND DIGEST IS NOT NULL");
+
+    if (!result)
+        return digests;
+
+    do
+    {
+        Field* fields = result->Fetch();
+
+        std::string table = GetWrittenTable(fields[1].Get<std::string>());
+        if (table.empty())
+            continue;
+
+        SASWriteDigestStats& stats = digests[fields[0].Get<std::string>()];
+        stats.Table = table;
+        stats.Statements = fields[2].Get<uint64>();
+        stats.Rows = fields[3].Get<uint64>();
+        stats.TotalPicoseconds = fields[4].Get<uint64>();
+        stats.MaxPicoseconds = fields[5].Get<uint64>();
+    } while (result->NextRow());
+
+    return digests;
+}
+
+void ServerAutoShutdown::WriteShutdownWriteProfile()
+{
+    _isWriteProfiling = false;
+
+    auto const& digests = GetWriteDigests();
+    if (digests.empty())
+    {
+        LOG_WARN("module", "> ServerAutoShutdown: Write profile is empty, is performance_schema enabled for the character database?");
+        return;
+    }
+
+    // Difference since the start of the window, grouped by table
+    std::map<std::string, SASWriteDigestStats> tables;
+    for (auto const& [digest, stats] : digests)
+    {
+        SASWriteDigestStats start;
+        if (auto itr = _writeProfileStart.find(digest); itr != _writeProfileStart.end())
+            start = itr->second;
+
+        // Not used in the window, or counters were reset (server restart, truncate)
+        if (stats.Statements <= start.Statements)
+            continue;
+
+        SASWriteDigestStats& table = tables[stats.Table];
+        table.Table = stats.Table;
+        table.Statements += stats.Statements - start.Statements;
+        table.Rows += stats.Rows - start.Rows;
+        table.TotalPicoseconds += stats.TotalPicoseconds - start.TotalPicoseconds;
+
+        // Only the max since the server start is known
+        table.MaxPicoseconds = std::max(table.MaxPicoseconds, stats.MaxPicoseconds);
+    }
+
+    std::vector<SASWriteDigestStats> sorted;
+    for (auto const& [name, table] : tables)
+        sorted.emplace_back(table);
+
+    std::sort(sorted.begin(), sorted.end(), [](SASWriteDigestStats const& left, SASWriteDigestStats const& right)
+    {
+        return left.TotalPicoseconds > right.TotalPicoseconds;
+    });
+
+    std::vector<std::string> lines;
+    for (SASWriteDigestStats const& table : sorted)
+    {
+        lines.emplace_back(Acore::StringFormatFmt("{}: {} statements, {} rows, total {:.1f} ms, avg {:.1f} us, max {:.1f} us",
+            table.Table, table.Statements, table.Rows, table.TotalPicoseconds / 1e9, table.TotalPicoseconds / 1e6 / table.Statements, table.MaxPicoseconds / 1e6));
+    }
+
+    LOG_INFO("module", "> ServerAutoShutdown: Shutdown write profile, {} tables", lines.size());
+    for (std::size_t i = 0; i < lines.size() && i < 10; ++i)
+        LOG_INFO("module", ">   {}", lines[i]);
+
+    std::string path = ServerAutoShutdownSettings::Get()->WriteProfileFile;
+    if (path.empty())
+        return;
+
+    std::ofstream file(path, std::ios::app);
+    if (!file)
+    {
+        LOG_ERROR("module", "> ServerAutoShutdown: Can't write the shutdown write profile to '{}'", path);
+        return;
+    }
+
+    file << "# Shutdown " << Acore::Time::TimeToTimestampStr(Seconds(time(nullptr))) << '\n';
+    for (std::string const& line : lines)
+        file << line << '\n';
+}
+
+void ServerAutoShutdown::StartProgressiveUnload()
+{
+    _isProgressiveUnload = true;
+    _unloadedGrids = 0;
+    _unloadQueue.clear();
+    _unloadCheckedGrids.clear();
+
+    // Empty maps first, they are the ones with grids to unload
+    sMapMgr->DoForAllMaps([this](Map* map)
+    {
+        if (!map->GetPlayersCountExceptGMs())
+            _unloadQueue.emplace_back(map->GetId(), map->GetInstanceId());
+    });
+
+    sMapMgr->DoForAllMaps([this](Map* map)
+    {
+        if (map->GetPlayersCountExceptGMs())
+            _unloadQueue.emplace_back(map->GetId(), map->GetInstanceId());
+    });
+
+    // Visited from the back
+    std::reverse(_unloadQueue.begin(), _unloadQueue.end());
+
+    LOG_DEBUG("module", "> ServerAutoShutdown: Progressive unload pass over {} maps", _unloadQueue.size());
+}
+
+void ServerAutoShutdown::UpdateProgressiveUnload()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    if (_unloadQueue.empty())
+    {
+        if (_unloadedGrids)
+            LOG_INFO("module", "> ServerAutoShutdown: Progressive unload - {} grids unloaded", _unloadedGrids);
+
+        // Players keep logging out during the countdown, start a new pass later
+        _isProgressiveUnload = false;
+
+        uint32 passSeconds = settings->ProgressiveUnloadPassSeconds;
+        scheduler.Schedule(Seconds(passSeconds), SAS_GROUP_COUNTDOWN, [this](TaskContext /*context*/)
+        {
+            StartProgressiveUnload();
+        });
+
+        return;
+    }
+
+    uint32 budget = settings->ProgressiveUnloadBudgetMs;
+    auto deadline = std::chrono::steady_clock::now() + Milliseconds(budget);
+
+    while (!_unloadQueue.empty() && std::chrono::steady_clock::now() < deadline)
+    {
+        auto [mapId, instanceId] = _unloadQueue.back();
+
+        Map* map = sMapMgr->FindMap(mapId, instanceId);
+        if (map)
+            _unloadedGrids += UnloadIdleGrids(map, deadline, &_unloadCheckedGrids);
+
+        // Out of time in the middle of the map, continue it next update after the grids already checked
+        if (map && std::chrono::steady_clock::now() >= deadline)
+            break;
+
+        _unloadQueue.pop_back();
+        _unloadCheckedGrids.clear();
+    }
+}
+
+void ServerAutoShutdown::CheckMapHealth()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    uint32 maxObjects = settings->MapHealthMaxObjects;
+    uint32 warnSeconds = settings->MapHealthWarnSeconds;
+    uint32 cooldownSeconds = settings->MapHealthCooldownSeconds;
+    auto policy = static_cast<SASMapHealthPolicy>(settings->MapHealthPolicy);
+    std::string warnMessage = settings->MapHealthMessage;
+    time_t now = GameTime::GetGameTime().count();
+
+    std::map<std::pair<uint32, uint32>, SASMapHealthInfo> mapHealth;
+
+    sMapMgr->DoForAllMaps([&](Map* map)
+    {
+        auto key = std::make_pair(map->GetId(), map->GetInstanceId());
+
+        // Keep the state of maps seen before, drop the destroyed ones
+        SASMapHealthInfo& info = mapHealth[key];
+        if (auto itr = _mapHealth.find(key); itr != _mapHealth.end())
+            info = itr->second;
+
+        auto& store = map->GetObjectsStore();
+        info.MapId = key.first;
+        info.InstanceId = key.second;
+        info.Objects = store.Size<Creature>() + store.Size<GameObject>() + store.Size<DynamicObject>();
+        info.Players = map->GetPlayersCountExceptGMs();
+
+        switch (info.State)
+        {
+            case SAS_MAP_HEALTHY:
+            {
+                if (!maxObjects || info.Objects <= maxObjects)
+                    break;
+
+                LOG_WARN("module", "> ServerAutoShutdown: Map {} ({}) instance {} is degraded, {} objects (max {}), {} players",
+                    map->GetMapName(), info.MapId, info.InstanceId, info.Objects, maxObjects, info.Players);
+
+                if (policy == SAS_MAP_POLICY_LOG)
+                {
+                    // Don't report it again on every check
+                    info.State = SAS_MAP_EVACUATED;
+                    info.StateTime = now;
+                    break;
+                }
+
+                std::string message = Acore::StringFormat(warnMessage, Acore::Time::ToTimeString<Seconds>(warnSeconds, TimeOutput::Seconds, TimeFormat::FullText));
+                map->DoForAllPlayers([&message](Player* player)
+                {
+                    sWorld->SendServerMessage(SERVER_MSG_STRING, message, player);
+                });
+
+                info.State = SAS_MAP_WARNED;
+                info.StateTime = now;
+                break;
+            }
+            case SAS_MAP_WARNED:
+            {
+                if (now < info.StateTime + warnSeconds)
+                    break;
+
+                EvacuateMap(map, policy);
+                info.State = SAS_MAP_EVACUATED;
+                info.StateTime = now;
+                break;
+            }
+            case SAS_MAP_EVACUATED:
+            {
+                // Players left with the next world update, now the grids can go
+                if (policy != SAS_MAP_POLICY_LOG && info.Objects > maxObjects)
+                {
+                    if (uint32 unloaded = UnloadIdleGrids(map))
+                        LOG_INFO("module", "> ServerAutoShutdown: Map {} ({}) instance {} unloaded {} grids", map->GetMapName(), info.MapId, info.InstanceId, unloaded);
+                }
+
+                if (now >= info.StateTime + cooldownSeconds)
+                    info.State = SAS_MAP_HEALTHY;
+
+                break;
+            }
+        }
+    });
+
+    _mapHealth = std::move(mapHealth);
+}
+
+void ServerAutoShutdown::EvacuateMap(Map* map, SASMapHealthPolicy policy)
+{
+    uint32 moved = 0;
+    uint32 kicked = 0;
+
+    map->DoForAllPlayers([map, policy, &moved, &kicked](Player* player)
+    {
+        if (policy == SAS_MAP_POLICY_TELEPORT && player->m_homebindMapId != map->GetId())
+        {
+            player->TeleportTo(player->m_homebindMapId, player->m_homebindX, player->m_homebindY, player->m_homebindZ, player->GetOrientation());
+            ++moved;
+            return;
+        }
+
+        player->GetSession()->KickPlayer("ServerAutoShutdown: map unload");
+        ++kicked;
+    });
+
+    LOG_INFO("module", "> ServerAutoShutdown: Map {} ({}) instance {} evacuated, {} players moved, {} kicked",
+        map->GetMapName(), map->GetId(), map->GetInstanceId(), moved, kicked);
+}
+
+void ServerAutoShutdown::CloseContentGate()
+{
+    if (_isContentGated)
+        return;
+
+    _isContentGated = true;
+
+    // Dungeon finder stops both joins and proposals with its options off
+    _savedLfgOptions = sLFGMgr->GetOptions();
+    sLFGMgr->SetOptions(0);
+
+    // Battleground and arena queues are held by the queue update hook, see ServerAutoShutdown_Battleground
+    LOG_INFO("module", "> ServerAutoShutdown: Battleground, arena and dungeon finder queues closed until the restart");
+}
+
+void ServerAutoShutdown::OpenContentGate()
+{
+    if (!_isContentGated)
+        return;
+
+    _isContentGated = false;
+    sLFGMgr->SetOptions(_savedLfgOptions);
+
+    LOG_INFO("module", "> ServerAutoShutdown: Battleground, arena and dungeon finder queues opened again");
+}
+
+float ServerAutoShutdown::GetDatabaseLatency(SASDatabasePool pool, uint8 percentile) const
+{
+    std::vector<float> samples = _databaseHealth[pool].Samples;
+    if (samples.empty())
+        return -1.0f;
+
+    std::size_t rank = std::min(samples.size() - 1, samples.size() * percentile / 100);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+void ServerAutoShutdown::AddDatabaseSample(SASDatabasePool pool, float milliseconds)
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    SASDatabaseHealthInfo& info = _databaseHealth[pool];
+    std::size_t window = settings->DatabaseHealthWindow;
+
+    if (info.Samples.size() < window)
+        info.Samples.emplace_back(milliseconds);
+    else
+        info.Samples[info.NextSample % window] = milliseconds;
+
+    info.NextSample = (info.NextSample + 1) % window;
+
+    // Compare once the window is filled again, a short spike is gone by then
+    if (info.IsConfirming && info.NextSample == 0)
+    {
+        LOG_INFO("module", "> ServerAutoShutdown: {} database latency one window later - p50 {:.1f} ms, p95 {:.1f} ms (before p95 {:.1f} ms)",
+            DatabasePoolNames[pool], GetDatabaseLatency(pool, 50), GetDatabaseLatency(pool, 95), info.ConfirmP95);
+
+        info.IsConfirming = false;
+
+        // Degraded for two full windows, only a restart will help
+        float maxP95 = settings->DatabaseHealthMaxP95;
+        if (maxP95 > 0.0f && GetDatabaseLatency(pool, 95) > maxP95)
+            RequestRestart(Acore::StringFormatFmt("{} database latency degraded for two windows", DatabasePoolNames[pool]));
+    }
+}
+
+void ServerAutoShutdown::ProbeDatabasePools()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    float maxP95 = settings->DatabaseHealthMaxP95;
+    uint32 cooldownSeconds = settings->DatabaseHealthCooldownSeconds;
+    std::size_t window = settings->DatabaseHealthWindow;
+    time_t now = GameTime::GetGameTime().count();
+
+    // The probe goes through the same async queue as the core queries, so queue time is included
+    auto Probe = [this](SASDatabasePool pool, auto& database)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+
+        queryProcessor.AddCallback(database.AsyncQuery("SELECT 1").WithCallback([this, pool, startTime](QueryResult /*result*/)
+        {
+            AddDatabaseSample(pool, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+        }));
+    };
+
+    Probe(SAS_DATABASE_LOGIN, LoginDatabase);
+    Probe(SAS_DATABASE_WORLD, WorldDatabase);
+    Probe(SAS_DATABASE_CHARACTER, CharacterDatabase);
+
+    if (maxP95 <= 0.0f)
+        return;
+
+    for (uint8 i = 0; i < MAX_SAS_DATABASE_POOLS; ++i)
+    {
+        auto pool = static_cast<SASDatabasePool>(i);
+        SASDatabaseHealthInfo& info = _databaseHealth[pool];
+
+        if (info.Samples.size() < window || info.IsConfirming || now < info.ConfirmTime + cooldownSeconds)
+            continue;
+
+        if (GetDatabaseLatency(pool, 95) <= maxP95)
+            continue;
+
+        LOG_INFO("module", "> ServerAutoShutdown: {} database latency degraded - p50 {:.1f} ms, p95 {:.1f} ms, checked again over a new window",
+            DatabasePoolNames[pool], GetDatabaseLatency(pool, 50), GetDatabaseLatency(pool, 95));
+
+        info.ConfirmP95 = GetDatabaseLatency(pool, 95);
+        info.IsConfirming = true;
+        info.ConfirmTime = now;
+        info.Samples.clear();
+        info.NextSample = 0;
+
+        // Only drops the connections the server already lost, the core has no way to reopen a live one
+        PingDatabasePool(pool);
+    }
+}
+
+void ServerAutoShutdown::PingDatabasePool(SASDatabasePool pool)
+{
+    switch (pool)
+    {
+        case SAS_DATABASE_LOGIN:
+            LoginDatabase.KeepAlive();
+            break;
+        case SAS_DATABASE_WORLD:
+            WorldDatabase.KeepAlive();
+            break;
+        case SAS_DATABASE_CHARACTER:
+            CharacterDatabase.KeepAlive();
+            break;
+        default:
+            break;
+    }
+}
+
+bool ServerAutoShutdown::StartSaveBenchmark(uint32 players, uint32 rowsPerPlayer, bool stub)
+{
+    if (_saveBenchmark || !players || !rowsPerPlayer)
+        return false;
+
+    _saveBenchmark = std::make_unique<SASSaveBenchmark>();
+    _saveBenchmark->IsStub = stub;
+    _saveBenchmark->Players = players;
+    _saveBenchmark->Pending = players;
+    _saveBenchmark->StartTime = std::chrono::steady_clock::now();
+    _saveBenchmark->Latencies.reserve(players);
+
+    uint32 payloadBytes = ServerAutoShutdownSettings::Get()->SaveBenchPayloadBytes;
+    std::string payload(payloadBytes, 'x');
+
+    LOG_INFO("module", "> ServerAutoShutdown: Save benchmark started, {} players x {} rows of {} bytes ({} sink)",
+        players, rowsPerPlayer, payloadBytes, stub ? "stub" : "database");
+
+    for (uint32 guid = 1; guid <= players; ++guid)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+
+        // Like a player save, one transaction with all the rows of the player
+        CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+        for (uint32 slot = 0; slot < rowsPerPlayer; ++slot)
+        {
+            std::string sql = Acore::StringFormatFmt("REPLACE INTO mod_server_auto_shutdown_save_bench (guid, slot, data) VALUES ({}, {}, '{}')", guid, slot, payload);
+            _saveBenchmark->Bytes += sql.size();
+            trans->Append(sql);
+        }
+
+        _saveBenchmark->Statements += rowsPerPlayer;
+
+        // The stub sink only measures building the saves
+        if (stub)
+        {
+            _saveBenchmark->Latencies.emplace_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+            --_saveBenchmark->Pending;
+            continue;
+        }
+
+        transactionProcessor.AddCallback(CharacterDatabase.AsyncCommitTransaction(trans).AfterComplete([this, startTime](bool /*success*/)
+        {
+            _saveBenchmark->Latencies.emplace_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+
+            if (!--_saveBenchmark->Pending)
+                FinishSaveBenchmark();
+        }));
+    }
+
+    if (stub)
+        FinishSaveBenchmark();
+
+    return true;
+}
+
+void ServerAutoShutdown::FinishSaveBenchmark()
+{
+    SASSaveBenchmark& bench = *_saveBenchmark;
+
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - bench.StartTime).count();
+    std::sort(bench.Latencies.begin(), bench.Latencies.end());
+
+    auto GetPercentile = [&bench](std::size_t percentile)
+    {
+        return bench.Latencies.empty() ? 0.0f : bench.Latencies[std::min(bench.Latencies.size() - 1, bench.Latencies.size() * percentile / 100)];
+    };
+
+    LOG_INFO("module", "> ServerAutoShutdown: Save benchmark ({} sink) - {} players, {} statements, {} KB in {:.2f} s, {:.0f} statements/s",
+        bench.IsStub ? "stub" : "database", bench.Players, bench.Statements, bench.Bytes >> 10, seconds, seconds > 0.0f ? bench.Statements / seconds : 0.0f);
+    LOG_INFO("module", "> ServerAutoShutdown: Save benchmark latency per player - p50 {:.1f} ms, p99 {:.1f} ms, max {:.1f} ms",
+        GetPercentile(50), GetPercentile(99), bench.Latencies.empty() ? 0.0f : bench.Latencies.back());
+
+    if (!bench.IsStub)
+        CharacterDatabase.Execute("DELETE FROM mod_server_auto_shutdown_save_bench");
+
+    _saveBenchmark.reset();
 }
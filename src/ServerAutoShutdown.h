@@ -19,6 +19,108 @@
 #define _SERVER_AUTO_SHUTDOWN_H_
 
 #include "Common.h"
+#include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+class Map;
+
+enum SASTaskGroup : uint32
+{
+    SAS_GROUP_SHUTDOWN = 1, // Rescheduled on every config reload
+    SAS_GROUP_STARTUP,      // Only scheduled once after the server start
+    SAS_GROUP_COUNTDOWN,    // Relative to the shutdown time, rescheduled when it changes
+    SAS_GROUP_CHILD         // Waits for forked processes, never cancelled
+};
+
+enum SASCoreReset : uint32
+{
+    SAS_RESET_DAILY_QUESTS   = 0x01,
+    SAS_RESET_WEEKLY_QUESTS  = 0x02,
+    SAS_RESET_MONTHLY_QUESTS = 0x04,
+    SAS_RESET_BATTLEGROUND   = 0x08,
+    SAS_RESET_ARENA_POINTS   = 0x10,
+    SAS_RESET_INSTANCES      = 0x20
+};
+
+enum SASSoftAction : uint32
+{
+    SAS_SOFT_ALLOCATOR_PURGE  = 0x01,
+    SAS_SOFT_UNLOAD_GRIDS     = 0x02,
+    SAS_SOFT_DATABASE_PING    = 0x04,
+
+    SAS_SOFT_ALL              = SAS_SOFT_ALLOCATOR_PURGE | SAS_SOFT_UNLOAD_GRIDS | SAS_SOFT_DATABASE_PING
+};
+
+enum SASMapHealthPolicy : uint8
+{
+    SAS_MAP_POLICY_LOG,       // Only report the degraded map
+    SAS_MAP_POLICY_TELEPORT,  // Send players to their homebind, kick if it's on the same map
+    SAS_MAP_POLICY_KICK       // Kick players of the map
+};
+
+enum SASMapHealthState : uint8
+{
+    SAS_MAP_HEALTHY,
+    SAS_MAP_WARNED,
+    SAS_MAP_EVACUATED
+};
+
+struct SASMapHealthInfo
+{
+    uint32 MapId = 0;
+    uint32 InstanceId = 0;
+    uint32 Objects = 0;
+    uint32 Players = 0;
+    SASMapHealthState State = SAS_MAP_HEALTHY;
+    time_t StateTime = 0;
+};
+
+enum SASDatabasePool : uint8
+{
+    SAS_DATABASE_LOGIN,
+    SAS_DATABASE_WORLD,
+    SAS_DATABASE_CHARACTER,
+
+    MAX_SAS_DATABASE_POOLS
+};
+
+// Round trip of probe queries through the async queue of one pool
+struct SASDatabaseHealthInfo
+{
+    std::vector<float> Samples;  // Milliseconds, ring buffer
+    std::size_t NextSample = 0;
+    bool IsConfirming = false;   // Over the limit once, checked again over a new window
+    float ConfirmP95 = 0.0f;     // Latency which started the check
+    time_t ConfirmTime = 0;
+};
+
+// Counters of one statement digest in performance_schema
+struct SASWriteDigestStats
+{
+    std::string Table;
+    uint64 Statements = 0;
+    uint64 Rows = 0;
+    uint64 TotalPicoseconds = 0;
+    uint64 MaxPicoseconds = 0;
+};
+
+// One run of the synthetic save benchmark
+struct SASSaveBenchmark
+{
+    bool IsStub = false;
+    uint32 Players = 0;
+    uint32 Pending = 0;
+    uint64 Statements = 0;
+    uint64 Bytes = 0;
+    std::chrono::steady_clock::time_point StartTime;
+    std::vector<float> Latencies;  // Milliseconds per player save
+};
 
 class ServerAutoShutdown
 {
@@ -26,11 +128,129 @@ public:
     static ServerAutoShutdown* instance();
 
     void Init();
+    void OnStartup();
+    void OnShutdown();
+    void OnShutdownCancel();
     void OnUpdate(uint32 diff);
     void StartPersistentGameEvents();
 
+    bool IsEnabled() const { return _isEnableModule; }
+
+    // Restart in these seconds through the same path as the scheduled one
+    void StartRestart(uint32 seconds, std::string_view reason);
+
+    // Restart sooner than the schedule because of a health signal, through the normal announce
+    void RequestRestart(std::string_view reason);
+
+    // Same from any thread, handled by the next world update
+    void ReportHealth(std::string reason);
+
+    // Keep players out (only gm accounts can log in) while any hold is active
+    void HoldAdmission(std::string_view reason);
+    void ReleaseAdmission(std::string_view reason);
+
+    uint32 GetStartupSeconds() const { return _startupSeconds; }
+
+    // Maps sorted by object count, most loaded first
+    std::vector<SASMapHealthInfo> GetMapHealth() const;
+
+    // Unload grids of the map without player or active object around, returns the unloaded count.
+    // Stops at the deadline, the remaining grids are left for the next call. Grids in checked are
+    // skipped and the ones checked now are added, so the next call goes on where this one stopped
+    uint32 UnloadIdleGrids(Map* map, std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(),
+        std::unordered_set<uint32>* checked = nullptr);
+
+    // Realm flag in the auth database, so clients don't try to log in a realm that isn't ready
+    void SetRealmOffline(bool offline);
+
+    // Battleground, arena and dungeon finder queues are closed before the restart
+    bool IsContentGated() const { return _isContentGated; }
+    void CloseContentGate();
+    void OpenContentGate();
+
+    // Percentile of the probe latency in milliseconds, negative without samples
+    float GetDatabaseLatency(SASDatabasePool pool, uint8 percentile) const;
+    // Ping every connection of the pool, the core reopens the lost ones
+    void PingDatabasePool(SASDatabasePool pool);
+
+    // Synthetic player saves through the character database async queue (or a stub sink),
+    // the result is logged once all of them are done. False if a run is already going
+    bool StartSaveBenchmark(uint32 players, uint32 rowsPerPlayer, bool stub);
+
+    // Line in 'ServerAutoShutdown.Timeline.File', extra is more json members
+    void RecordTimeline(std::string_view event, std::string_view extra = {});
+
 private:
+    void ScheduleCountdownTasks(uint32 diffToShutdown);
+    void AnnounceRestart(uint32 seconds);
+    void ScheduleFaults(uint32 diffToShutdown);
+    void DelayCountdown(uint32 seconds);
+    void UpdateWatchdog();
+    void DisarmWatchdog();
+    bool AcquireRestartLease();
+    void ScheduleLeaseHeartbeat(SASTaskGroup group);
+    void ReleaseRestartLease();
+    void SetReady();
+    void ScheduleSoftMaintenance(time_t nowTime);
+    void RunSoftMaintenance();
+    void DumpBufferPool();
+    void StartBufferPoolLoad();
+    float GetBufferPoolLoadProgress(std::string& status);
+    void WriteCheckpointMarker(std::string const& path);
+    void CheckMapHealth();
+    void EvacuateMap(Map* map, SASMapHealthPolicy policy);
+    void RotateLogs();
+    std::map<std::string, SASWriteDigestStats> GetWriteDigests();
+    void WriteShutdownWriteProfile();
+    void StartProgressiveUnload();
+    void UpdateProgressiveUnload();
+    void FinishSaveBenchmark();
+    void StartProfile();
+    void StopProfile();
+    void CheckDeploy();
+    void ProbeDatabasePools();
+    void AddDatabaseSample(SASDatabasePool pool, float milliseconds);
+
     bool _isEnableModule = false;
+    uint32 _startupSeconds = 0;
+    bool _isHealthRestart = false;
+    time_t _shutdownTime = 0;
+
+    // The daily restart, skipped by the next init once it was cancelled
+    time_t _scheduledShutdownTime = 0;
+    time_t _cancelledShutdownTime = 0;
+    bool _isScheduledRestart = false;
+    bool _isInitCancel = false;
+
+    std::mutex _healthReportsLock;
+    std::vector<std::string> _healthReports;
+
+    bool _isRealmOffline = false;
+
+    // Character database writes since the start of the shutdown save window
+    bool _isWriteProfiling = false;
+    std::map<std::string, SASWriteDigestStats> _writeProfileStart;
+
+    bool _isContentGated = false;
+    uint32 _savedLfgOptions = 0;
+
+    // Maps left to visit in the current progressive unload pass
+    bool _isProgressiveUnload = false;
+    std::vector<std::pair<uint32, uint32>> _unloadQueue;
+    std::unordered_set<uint32> _unloadCheckedGrids;  // Of the map at the back of the queue
+    uint32 _unloadedGrids = 0;
+
+    uint32 _admissionHolds = 0;
+    AccountTypes _savedSecurityLimit = SEC_PLAYER;
+
+    std::map<std::pair<uint32, uint32>, SASMapHealthInfo> _mapHealth;
+    std::array<SASDatabaseHealthInfo, MAX_SAS_DATABASE_POOLS> _databaseHealth;
+
+    std::unique_ptr<SASSaveBenchmark> _saveBenchmark;
+
+    std::string _pendingDeploy;
+
+    bool _hasRestartLease = false;
 };
 
 #define sSAS ServerAutoShutdown::instance()
@@ -0,0 +1,143 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServerAutoShutdownAllocator.h"
+#include "ServerAutoShutdownSettings.h"
+#include "Log.h"
+#include "StringFormat.h"
+#include <array>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+// Resolved only when the server is linked with jemalloc. Linux only, the macOS linker needs a weak
+// reference resolved at link time
+extern "C" int mallctl(char const* name, void* oldp, size_t* oldlenp, void* newp, size_t newlen) __attribute__((weak));
+#endif
+
+namespace
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    template<class T>
+    bool WriteMallctl(std::string const& name, T value)
+    {
+        if (int error = mallctl(name.c_str(), nullptr, nullptr, &value, sizeof(value)))
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: jemalloc '{}' can't be set to {} (error {})", name, value, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    void ApplyJemallocProfile(SASSettings const& settings)
+    {
+        if (Optional<int64> backgroundThread = settings.AllocatorBackgroundThread)
+            WriteMallctl<bool>("background_thread", *backgroundThread != 0);
+
+        unsigned arenas = 0;
+        size_t size = sizeof(arenas);
+        mallctl("arenas.narenas", &arenas, &size, nullptr, 0);
+
+        // Default of new arenas, then every existing one
+        std::array<std::pair<char const*, Optional<int64>>, 2> decays =
+        { {
+            { "dirty_decay_ms", settings.AllocatorDirtyDecayMs },
+            { "muzzy_decay_ms", settings.AllocatorMuzzyDecayMs }
+        } };
+
+        for (auto const& [decay, value] : decays)
+        {
+            if (!value)
+                continue;
+
+            if (!WriteMallctl<ssize_t>(Acore::StringFormatFmt("arenas.{}", decay), ssize_t(*value)))
+                continue;
+
+            for (unsigned i = 0; i < arenas; ++i)
+                WriteMallctl<ssize_t>(Acore::StringFormatFmt("arena.{}.{}", i, decay), ssize_t(*value));
+        }
+
+        // Fixed at the process start, only MALLOC_CONF can change it
+        if (Optional<int64> narenas = settings.AllocatorNArenas; narenas && unsigned(*narenas) != arenas)
+            LOG_WARN("module", "> ServerAutoShutdown: jemalloc runs with {} arenas, start the server with MALLOC_CONF=narenas:{} to change it", arenas, *narenas);
+    }
+#endif
+
+#if defined(__GLIBC__)
+    void ApplyGlibcProfile(SASSettings const& settings)
+    {
+        if (Optional<int64> arenaMax = settings.AllocatorArenaMax)
+            if (!mallopt(M_ARENA_MAX, int(*arenaMax)))
+                LOG_ERROR("module", "> ServerAutoShutdown: glibc M_ARENA_MAX can't be set to {}", *arenaMax);
+
+        if (Optional<int64> trimThreshold = settings.AllocatorTrimThreshold)
+            if (!mallopt(M_TRIM_THRESHOLD, int(*trimThreshold)))
+                LOG_ERROR("module", "> ServerAutoShutdown: glibc M_TRIM_THRESHOLD can't be set to {}", *trimThreshold);
+    }
+#endif
+}
+
+std::string ServerAutoShutdownAllocator::GetName()
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    if (mallctl)
+        return "jemalloc";
+#endif
+
+#if defined(__GLIBC__)
+    return "glibc";
+#else
+    return "unknown";
+#endif
+}
+
+void ServerAutoShutdownAllocator::ApplyProfile()
+{
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    std::string const& profile = settings->AllocatorProfile;
+    if (profile.empty())
+        return;
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    if (mallctl)
+        ApplyJemallocProfile(*settings);
+#endif
+
+#if defined(__GLIBC__)
+    if (GetName() == "glibc")
+        ApplyGlibcProfile(*settings);
+#endif
+
+    LOG_INFO("module", "> ServerAutoShutdown: Allocator profile '{}' applied to {}", profile, GetName());
+}
+
+void ServerAutoShutdownAllocator::Purge()
+{
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    // MALLCTL_ARENAS_ALL
+    if (mallctl)
+        mallctl("arena.4096.purge", nullptr, nullptr, nullptr, 0);
+#endif
+}
@@ -0,0 +1,37 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SERVER_AUTO_SHUTDOWN_ALLOCATOR_H_
+#define _SERVER_AUTO_SHUTDOWN_ALLOCATOR_H_
+
+#include "Common.h"
+#include <string>
+
+// Tuning of the allocator the server runs with, glibc malloc or jemalloc
+namespace ServerAutoShutdownAllocator
+{
+    // "jemalloc", "glibc" or "unknown"
+    std::string GetName();
+
+    // Apply the ServerAutoShutdown.Allocator.* options
+    void ApplyProfile();
+
+    // Give memory freed by the core back to the system
+    void Purge();
+}
+
+#endif /* _SERVER_AUTO_SHUTDOWN_ALLOCATOR_H_ */
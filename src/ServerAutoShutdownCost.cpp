@@ -0,0 +1,131 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServerAutoShutdownCost.h"
+#include "StringFormat.h"
+#include <chrono>
+
+#if AC_PLATFORM != AC_PLATFORM_WINDOWS
+#include <ctime>
+#endif
+
+namespace
+{
+    constexpr std::array<char const*, MAX_SAS_COST_POINTS> CostPointNames =
+    {
+        "OnUpdate",
+        "Init",
+        "Announce",
+        "Sampler"
+    };
+
+    uint8 GetBucket(uint64 nanoseconds)
+    {
+        uint8 bucket = 0;
+
+        for (uint64 micro = nanoseconds / 1000; micro && bucket < ServerAutoShutdownCost::HISTOGRAM_BUCKETS - 1; micro >>= 1)
+            ++bucket;
+
+        return bucket;
+    }
+
+    // Upper bound of the bucket in microseconds
+    uint64 GetBucketLimit(uint8 bucket)
+    {
+        return uint64(1) << bucket;
+    }
+}
+
+/*static*/ ServerAutoShutdownCost* ServerAutoShutdownCost::instance()
+{
+    static ServerAutoShutdownCost instance;
+    return &instance;
+}
+
+/*static*/ uint64 ServerAutoShutdownCost::Now()
+{
+#if AC_PLATFORM != AC_PLATFORM_WINDOWS
+    timespec ts{};
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return uint64(ts.tv_sec) * 1000000000 + uint64(ts.tv_nsec) + 1;
+#endif
+
+    return uint64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void ServerAutoShutdownCost::Add(SASCostPoint point, uint64 nanoseconds)
+{
+    CostStats& stats = _stats[point];
+
+    stats.Calls.fetch_add(1, std::memory_order_relaxed);
+    stats.TotalNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+    stats.Histogram[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64 max = stats.MaxNs.load(std::memory_order_relaxed);
+    while (nanoseconds > max && !stats.MaxNs.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) { }
+}
+
+void ServerAutoShutdownCost::Reset()
+{
+    for (auto& stats : _stats)
+    {
+        stats.Calls.store(0, std::memory_order_relaxed);
+        stats.TotalNs.store(0, std::memory_order_relaxed);
+        stats.MaxNs.store(0, std::memory_order_relaxed);
+
+        for (auto& bucket : stats.Histogram)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::vector<std::string> ServerAutoShutdownCost::GetReport() const
+{
+    std::vector<std::string> report;
+
+    for (uint8 i = 0; i < MAX_SAS_COST_POINTS; ++i)
+    {
+        CostStats const& stats = _stats[i];
+
+        uint64 calls = stats.Calls.load(std::memory_order_relaxed);
+        if (!calls)
+            continue;
+
+        uint64 totalNs = stats.TotalNs.load(std::memory_order_relaxed);
+
+        // Percentiles are the upper bound of the bucket they fall into
+        auto GetPercentile = [&stats, calls](uint32 percent)
+        {
+            uint64 rank = (calls * percent + 99) / 100;
+            uint64 seen = 0;
+
+            for (uint8 bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket)
+            {
+                seen += stats.Histogram[bucket].load(std::memory_order_relaxed);
+                if (seen >= rank)
+                    return GetBucketLimit(bucket);
+            }
+
+            return GetBucketLimit(HISTOGRAM_BUCKETS - 1);
+        };
+
+        report.emplace_back(Acore::StringFormatFmt("{}: calls {}, total {:.3f} ms, avg {} us, p50 <{} us, p99 <{} us, max {} us",
+            CostPointNames[i], calls, totalNs / 1000000.0, totalNs / calls / 1000, GetPercentile(50), GetPercentile(99),
+            stats.MaxNs.load(std::memory_order_relaxed) / 1000));
+    }
+
+    return report;
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SERVER_AUTO_SHUTDOWN_COST_H_
+#define _SERVER_AUTO_SHUTDOWN_COST_H_
+
+#include "Common.h"
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+enum SASCostPoint : uint8
+{
+    SAS_COST_UPDATE,
+    SAS_COST_INIT,
+    SAS_COST_ANNOUNCE,
+    SAS_COST_SAMPLER,
+
+    MAX_SAS_COST_POINTS
+};
+
+// Per-call cpu time of the module own callbacks, kept in log2 buckets
+// starting at 1 microsecond (bucket 0 is everything below that)
+class ServerAutoShutdownCost
+{
+public:
+    static constexpr uint8 HISTOGRAM_BUCKETS = 24;
+
+    static ServerAutoShutdownCost* instance();
+
+    // Thread cpu time in nanoseconds, wall clock where it is not available
+    static uint64 Now();
+
+    void SetEnabled(bool enabled) { _isEnabled.store(enabled, std::memory_order_relaxed); }
+    bool IsEnabled() const { return _isEnabled.load(std::memory_order_relaxed); }
+
+    void Add(SASCostPoint point, uint64 nanoseconds);
+    void Reset();
+
+    std::vector<std::string> GetReport() const;
+
+private:
+    struct CostStats
+    {
+        std::atomic<uint64> Calls{ 0 };
+        std::atomic<uint64> TotalNs{ 0 };
+        std::atomic<uint64> MaxNs{ 0 };
+        std::array<std::atomic<uint64>, HISTOGRAM_BUCKETS> Histogram{};
+    };
+
+    std::atomic<bool> _isEnabled{ false };
+    std::array<CostStats, MAX_SAS_COST_POINTS> _stats;
+};
+
+#define sSASCost ServerAutoShutdownCost::instance()
+
+// Measure the enclosing scope, does nothing if instrumentation is disabled
+class SASCostScope
+{
+public:
+    explicit SASCostScope(SASCostPoint point) : _point(point),
+        _start(sSASCost->IsEnabled() ? ServerAutoShutdownCost::Now() : 0) { }
+
+    ~SASCostScope()
+    {
+        if (_start)
+            sSASCost->Add(_point, ServerAutoShutdownCost::Now() - _start);
+    }
+
+    SASCostScope(SASCostScope const&) = delete;
+    SASCostScope& operator=(SASCostScope const&) = delete;
+
+private:
+    SASCostPoint _point;
+    uint64 _start;
+};
+
+#endif /* _SERVER_AUTO_SHUTDOWN_COST_H_ */
@@ -0,0 +1,131 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServerAutoShutdownDump.h"
+#include "Log.h"
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    // ioprio_set, not wrapped by glibc
+    constexpr int IOPRIO_WHO_PROCESS = 1;
+    constexpr int IOPRIO_CLASS_IDLE = 3;
+    constexpr int IOPRIO_CLASS_SHIFT = 13;
+
+    // Only async signal safe calls, the other threads of the server don't exist in the child
+    [[noreturn]] void WriteCore(char const* directory, char const* filter, long maxFd)
+    {
+        // Sockets and files of the server, the listening world port above all, are not held while
+        // the core is written (the next server must bind it)
+#ifdef SYS_close_range
+        if (syscall(SYS_close_range, 3U, ~0U, 0U) < 0)
+#endif
+        {
+            for (int fd = 3; fd < maxFd; ++fd)
+                close(fd);
+        }
+
+        setpriority(PRIO_PROCESS, 0, 19);
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+
+        rlimit limit = { RLIM_INFINITY, RLIM_INFINITY };
+        setrlimit(RLIMIT_CORE, &limit);
+
+        // Mappings in the core, e.g. 0x23 - anonymous private and shared, huge pages
+        if (*filter)
+        {
+            int fd = open("/proc/self/coredump_filter", O_WRONLY);
+            if (fd >= 0)
+            {
+                ssize_t length = 0;
+                while (filter[length])
+                    ++length;
+
+                if (write(fd, filter, length) < 0) { }
+                close(fd);
+            }
+        }
+
+        // A relative core_pattern writes into the working directory
+        if (*directory && chdir(directory) < 0)
+            _exit(1);
+
+        signal(SIGABRT, SIG_DFL);
+        raise(SIGABRT);
+        _exit(1);
+    }
+#endif
+}
+
+uint32 ServerAutoShutdownDump::ForkCore(std::string const& directory, std::string const& filter)
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    char const* directoryPath = directory.c_str();
+    char const* filterValue = filter.c_str();
+    long maxFd = sysconf(_SC_OPEN_MAX);
+
+    // One fork, the world thread only waits for the page tables to be copied
+    pid_t dumper = fork();
+    if (!dumper)
+        WriteCore(directoryPath, filterValue, maxFd);
+
+    if (dumper < 0)
+    {
+        LOG_ERROR("module", "> ServerAutoShutdown: Can't fork for the core dump (error {})", errno);
+        return 0;
+    }
+
+    return static_cast<uint32>(dumper);
+#else
+    (void)directory;
+    (void)filter;
+    LOG_WARN("module", "> ServerAutoShutdown: Core dumps of the running server are only supported on Linux");
+    return 0;
+#endif
+}
+
+bool ServerAutoShutdownDump::Reap(uint32 pid)
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    int status = 0;
+    pid_t result = waitpid(static_cast<pid_t>(pid), &status, WNOHANG);
+
+    // Still writing
+    if (!result)
+        return false;
+
+    if (result > 0 && WIFSIGNALED(status))
+        LOG_INFO("module", "> ServerAutoShutdown: Core dump process {} done{}", pid, WCOREDUMP(status) ? "" : ", no core written (check the core limit and core_pattern)");
+    else
+        LOG_WARN("module", "> ServerAutoShutdown: Core dump process {} exited without a core", pid);
+
+    return true;
+#else
+    (void)pid;
+    return true;
+#endif
+}
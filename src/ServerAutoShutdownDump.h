@@ -0,0 +1,35 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SERVER_AUTO_SHUTDOWN_DUMP_H_
+#define _SERVER_AUTO_SHUTDOWN_DUMP_H_
+
+#include "Common.h"
+#include <string>
+
+// Core dump of the running process image, written by a forked copy of it
+namespace ServerAutoShutdownDump
+{
+    // Fork a copy-on-write child which writes a core at the lowest cpu and io priority into the
+    // directory (through the kernel core_pattern) while this process goes on. Pid of the child, 0 on error
+    uint32 ForkCore(std::string const& directory, std::string const& filter);
+
+    // Collect the child once it's done, false while it's still writing
+    bool Reap(uint32 pid);
+}
+
+#endif /* _SERVER_AUTO_SHUTDOWN_DUMP_H_ */
@@ -0,0 +1,358 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServerAutoShutdownProfiler.h"
+#include "Duration.h"
+#include "Log.h"
+#include "StringConvert.h"
+#include "StringFormat.h"
+#include "Timer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+#include <cerrno>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <linux/perf_event.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    // Ring buffer of every thread, a power of two
+    constexpr std::size_t DATA_PAGES = 64;
+
+    std::size_t GetPageSize()
+    {
+        static std::size_t const pageSize = std::size_t(sysconf(_SC_PAGESIZE));
+        return pageSize;
+    }
+
+    std::string GetThreadName(std::string const& tid)
+    {
+        std::ifstream comm("/proc/self/task/" + tid + "/comm");
+        std::string name;
+        std::getline(comm, name);
+        return name;
+    }
+
+    // Copy out of the ring buffer, the record may wrap around its end
+    void ReadRing(uint8 const* data, uint64 size, uint64 offset, void* destination, std::size_t length)
+    {
+        uint8* output = static_cast<uint8*>(destination);
+        offset &= size - 1;
+
+        std::size_t first = std::min<std::size_t>(length, size - offset);
+        std::memcpy(output, data + offset, first);
+        std::memcpy(output + first, data, length - first);
+    }
+
+    // Function name, or the object file and offset for addr2line when the symbol isn't exported
+    std::string GetFrameName(uint64 address)
+    {
+        Dl_info info{};
+        if (!dladdr(reinterpret_cast<void*>(address), &info) || !info.dli_fname)
+            return Acore::StringFormatFmt("0x{:x}", address);
+
+        std::string name;
+        if (info.dli_sname)
+        {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            name = demangled && !status ? demangled : info.dli_sname;
+            free(demangled);
+        }
+        else
+            name = Acore::StringFormatFmt("{}+0x{:x}", std::filesystem::path(info.dli_fname).filename().string(),
+                address - reinterpret_cast<uint64>(info.dli_fbase));
+
+        // ';' separates the frames of a folded stack
+        std::replace(name.begin(), name.end(), ';', ':');
+        return name;
+    }
+#endif
+}
+
+/*static*/ ServerAutoShutdownProfiler* ServerAutoShutdownProfiler::instance()
+{
+    static ServerAutoShutdownProfiler instance;
+    return &instance;
+}
+
+ServerAutoShutdownProfiler::~ServerAutoShutdownProfiler()
+{
+    Stop();
+    Wait();
+}
+
+bool ServerAutoShutdownProfiler::Start(std::vector<std::string> const& threadNames, uint32 frequency, uint32 seconds, std::string path)
+{
+    Stop();
+
+    // Not waited for here, the caller is the world thread
+    if (_isRunning)
+    {
+        LOG_WARN("module", "> ServerAutoShutdown: The last profile is still being written, no new profile");
+        return false;
+    }
+
+    Wait();
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    // Sampled by their own on-cpu time, user space stacks only (allowed with perf_event_paranoid 2)
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_TASK_CLOCK;
+    attr.freq = 1;
+    attr.sample_freq = std::max<uint32>(frequency, 1);
+    attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_callchain_kernel = 1;
+
+    std::error_code error;
+    for (auto const& entry : std::filesystem::directory_iterator("/proc/self/task", error))
+    {
+        std::string tid = entry.path().filename().string();
+
+        ThreadEvent event;
+        event.Name = GetThreadName(tid);
+        if (std::find(threadNames.begin(), threadNames.end(), event.Name) == threadNames.end())
+            continue;
+
+        event.Fd = int(syscall(SYS_perf_event_open, &attr, Acore::StringTo<pid_t>(tid).value_or(0), -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (event.Fd < 0)
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: Can't profile thread {} '{}' ({}), check kernel.perf_event_paranoid", tid, event.Name, std::strerror(errno));
+            continue;
+        }
+
+        event.Buffer = mmap(nullptr, (DATA_PAGES + 1) * GetPageSize(), PROT_READ | PROT_WRITE, MAP_SHARED, event.Fd, 0);
+        if (event.Buffer == MAP_FAILED)
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: Can't map the profile buffer of thread {} '{}' ({})", tid, event.Name, std::strerror(errno));
+            close(event.Fd);
+            continue;
+        }
+
+        _events.push_back(std::move(event));
+    }
+
+    if (_events.empty())
+    {
+        LOG_ERROR("module", "> ServerAutoShutdown: No thread profiled");
+        return false;
+    }
+
+    LOG_INFO("module", "> ServerAutoShutdown: Profiling {} threads at {} Hz for {}", _events.size(), attr.sample_freq, Acore::Time::ToTimeString<Seconds>(seconds));
+
+    _stacks.clear();
+    _samples = 0;
+    _lostSamples = 0;
+    _path = std::move(path);
+    _isStopping = false;
+    _isRunning = true;
+    _thread = std::thread(&ServerAutoShutdownProfiler::Run, this, seconds);
+    return true;
+#else
+    (void)threadNames;
+    (void)frequency;
+    (void)seconds;
+    (void)path;
+    LOG_WARN("module", "> ServerAutoShutdown: The profiler is only supported on Linux");
+    return false;
+#endif
+}
+
+void ServerAutoShutdownProfiler::Stop()
+{
+    _isStopping = true;
+}
+
+void ServerAutoShutdownProfiler::Wait()
+{
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void ServerAutoShutdownProfiler::Run(uint32 seconds)
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    auto endTime = std::chrono::steady_clock::now() + Seconds(seconds);
+
+    std::vector<pollfd> fds;
+    for (ThreadEvent const& event : _events)
+        fds.push_back({ event.Fd, POLLIN, 0 });
+
+    // The buffers are drained on a short poll, a sample doesn't need a wakeup of its own
+    while (!_isStopping && std::chrono::steady_clock::now() < endTime)
+    {
+        poll(fds.data(), fds.size(), 100);
+
+        for (ThreadEvent const& event : _events)
+            ReadSamples(event);
+    }
+
+    for (ThreadEvent const& event : _events)
+        ReadSamples(event);
+#else
+    (void)seconds;
+#endif
+
+    CloseEvents();
+    Write();
+
+    _isRunning = false;
+}
+
+void ServerAutoShutdownProfiler::ReadSamples(ThreadEvent const& event)
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    perf_event_mmap_page* page = static_cast<perf_event_mmap_page*>(event.Buffer);
+    uint8 const* data = static_cast<uint8 const*>(event.Buffer) + GetPageSize();
+    uint64 size = DATA_PAGES * GetPageSize();
+
+    uint64 head = __atomic_load_n(&page->data_head, __ATOMIC_ACQUIRE);
+    uint64 tail = page->data_tail;
+
+    std::vector<uint8> record;
+    while (tail < head)
+    {
+        perf_event_header header;
+        ReadRing(data, size, tail, &header, sizeof(header));
+        if (header.size < sizeof(header))
+            break;
+
+        record.resize(header.size);
+        ReadRing(data, size, tail, record.data(), header.size);
+        tail += header.size;
+
+        // Sample - pid, tid, then the callchain (nr, ips)
+        if (header.type == PERF_RECORD_SAMPLE && header.size >= sizeof(header) + 16)
+        {
+            uint64 count = 0;
+            std::memcpy(&count, record.data() + sizeof(header) + 8, sizeof(count));
+            count = std::min<uint64>(count, (header.size - sizeof(header) - 16) / sizeof(uint64));
+
+            std::vector<uint64> callchain;
+            callchain.reserve(count);
+
+            for (uint64 i = 0; i < count; ++i)
+            {
+                uint64 address = 0;
+                std::memcpy(&address, record.data() + sizeof(header) + 16 + i * sizeof(uint64), sizeof(address));
+
+                // Context markers (PERF_CONTEXT_USER...), not addresses
+                if (address < uint64(PERF_CONTEXT_MAX))
+                    callchain.push_back(address);
+            }
+
+            if (!callchain.empty())
+            {
+                ++_stacks[{ event.Name, std::move(callchain) }];
+                ++_samples;
+            }
+        }
+        // Lost - id, lost
+        else if (header.type == PERF_RECORD_LOST && header.size >= sizeof(header) + 16)
+        {
+            uint64 lost = 0;
+            std::memcpy(&lost, record.data() + sizeof(header) + 8, sizeof(lost));
+            _lostSamples += lost;
+        }
+    }
+
+    __atomic_store_n(&page->data_tail, tail, __ATOMIC_RELEASE);
+#else
+    (void)event;
+#endif
+}
+
+void ServerAutoShutdownProfiler::CloseEvents()
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    for (ThreadEvent const& event : _events)
+    {
+        munmap(event.Buffer, (DATA_PAGES + 1) * GetPageSize());
+        close(event.Fd);
+    }
+#endif
+
+    _events.clear();
+}
+
+void ServerAutoShutdownProfiler::Write()
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    LOG_INFO("module", "> ServerAutoShutdown: Profile done, {} samples ({} lost), {} stacks", _samples, _lostSamples, _stacks.size());
+
+    if (_stacks.empty())
+        return;
+
+    // Every address is resolved once, the same frames are in most stacks
+    std::unordered_map<uint64, std::string> frameNames;
+
+    // Folded - root first, "thread;frame;...;leaf samples". Different addresses in the same
+    // functions are the same stack once resolved
+    std::map<std::string, uint64> folded;
+    for (auto const& [key, samples] : _stacks)
+    {
+        auto const& [threadName, callchain] = key;
+        std::string stack = threadName;
+
+        for (std::size_t i = callchain.size(); i-- > 0;)
+        {
+            // Return addresses point after the call, so the caller line is found from the byte before
+            uint64 address = i ? callchain[i] - 1 : callchain[i];
+
+            auto itr = frameNames.find(address);
+            if (itr == frameNames.end())
+                itr = frameNames.emplace(address, GetFrameName(address)).first;
+
+            stack += ';';
+            stack += itr->second;
+        }
+
+        folded[stack] += samples;
+    }
+
+    std::ofstream file(_path, std::ios::trunc);
+    if (!file)
+    {
+        LOG_ERROR("module", "> ServerAutoShutdown: Can't write the profile to '{}'", _path);
+        return;
+    }
+
+    for (auto const& [stack, samples] : folded)
+        file << stack << ' ' << samples << '\n';
+
+    LOG_INFO("module", "> ServerAutoShutdown: Profile written to '{}'", _path);
+#endif
+
+    _stacks.clear();
+}
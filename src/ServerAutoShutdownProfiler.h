@@ -0,0 +1,74 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SERVER_AUTO_SHUTDOWN_PROFILER_H_
+#define _SERVER_AUTO_SHUTDOWN_PROFILER_H_
+
+#include "Common.h"
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// On-cpu stacks of the server threads (perf_event_open), folded for a flame graph
+class ServerAutoShutdownProfiler
+{
+public:
+    static ServerAutoShutdownProfiler* instance();
+
+    ~ServerAutoShutdownProfiler();
+
+    // Sample the threads with one of the names for the seconds, the stacks are written to the file
+    // once done or stopped. False if nothing could be sampled or the last profile is still being written
+    bool Start(std::vector<std::string> const& threadNames, uint32 frequency, uint32 seconds, std::string path);
+
+    // Ends the sampling, the stacks are symbolised and written on the profiler thread
+    void Stop();
+
+    // Blocks until the profile is written
+    void Wait();
+
+private:
+    struct ThreadEvent
+    {
+        int Fd = -1;
+        void* Buffer = nullptr;
+        std::string Name;
+    };
+
+    void Run(uint32 seconds);
+    void ReadSamples(ThreadEvent const& event);
+    void CloseEvents();
+    void Write();
+
+    std::thread _thread;
+    std::atomic<bool> _isStopping{ false };
+    std::atomic<bool> _isRunning{ false };
+
+    // Profiler thread only while it runs
+    std::vector<ThreadEvent> _events;
+    std::map<std::pair<std::string, std::vector<uint64>>, uint32> _stacks;  // Thread name, callchain leaf first - samples
+    uint64 _samples = 0;
+    uint64 _lostSamples = 0;
+    std::string _path;
+};
+
+#define sSASProfiler ServerAutoShutdownProfiler::instance()
+
+#endif /* _SERVER_AUTO_SHUTDOWN_PROFILER_H_ */
@@ -0,0 +1,610 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServerAutoShutdownSampler.h"
+#include "ServerAutoShutdown.h"
+#include "ServerAutoShutdownAllocator.h"
+#include "ServerAutoShutdownCost.h"
+#include "ServerAutoShutdownSettings.h"
+#include "GameTime.h"
+#include "Log.h"
+#include "StringConvert.h"
+#include "StringFormat.h"
+#include "Tokenize.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#if AC_PLATFORM != AC_PLATFORM_WINDOWS
+#include <unistd.h>
+#endif
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+    // Two weeks of hourly history
+    constexpr std::size_t MAX_MEMORY_HOURS = 24 * 14;
+
+    // Resident set size in bytes, 0 if unknown
+    uint64 GetResidentSize()
+    {
+#if AC_PLATFORM != AC_PLATFORM_WINDOWS
+        std::ifstream statm("/proc/self/statm");
+        uint64 size = 0;
+        uint64 resident = 0;
+
+        if (statm >> size >> resident)
+            return resident * uint64(sysconf(_SC_PAGESIZE));
+#endif
+
+        return 0;
+    }
+
+    // smaps_rollup values are in kB, false if it can't be read (kernel before 4.14)
+    bool GetMemoryBreakdown(uint64& rss, SASMemoryBreakdown& breakdown)
+    {
+#if AC_PLATFORM != AC_PLATFORM_WINDOWS
+        std::ifstream rollup("/proc/self/smaps_rollup");
+        if (!rollup)
+            return false;
+
+        std::map<std::string, uint64> values;
+        std::string key;
+        uint64 value = 0;
+        std::string unit;
+
+        // The first line is the address range, it doesn't parse and is skipped
+        std::string line;
+        while (std::getline(rollup, line))
+        {
+            std::istringstream stream(line);
+            if (stream >> key >> value >> unit && key.back() == ':')
+                values[key.substr(0, key.size() - 1)] = value << 10;
+        }
+
+        if (!values.count("Rss") || !values.count("Anonymous"))
+            return false;
+
+        rss = values["Rss"];
+        breakdown.Anonymous = values["Anonymous"];
+        breakdown.Shmem = values["Pss_Shmem"];
+        breakdown.Swap = values["Swap"];
+        breakdown.Dirty = values["Shared_Dirty"] + values["Private_Dirty"];
+        breakdown.Clean = values["Shared_Clean"] + values["Private_Clean"];
+
+        // Pss_File since kernel 5.9, otherwise everything else than anonymous and shmem
+        if (values.count("Pss_File"))
+            breakdown.File = values["Pss_File"];
+        else
+            breakdown.File = rss > breakdown.Anonymous + breakdown.Shmem ? rss - breakdown.Anonymous - breakdown.Shmem : 0;
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    struct ThreadStat
+    {
+        std::string Name;
+        uint64 Ticks = 0;  // User and system cpu time
+    };
+
+    // /proc/self/task/<tid>/stat - "tid (name) state ..." with utime and stime as 14th and 15th fields
+    std::unordered_map<uint32, ThreadStat> GetThreadStats()
+    {
+        std::unordered_map<uint32, ThreadStat> stats;
+
+#if AC_PLATFORM != AC_PLATFORM_WINDOWS
+        std::error_code error;
+        for (auto const& entry : std::filesystem::directory_iterator("/proc/self/task", error))
+        {
+            Optional<uint32> tid = Acore::StringTo<uint32>(entry.path().filename().string());
+            if (!tid)
+                continue;
+
+            std::ifstream file(entry.path() / "stat");
+            std::string line;
+            if (!std::getline(file, line))
+                continue;
+
+            // The name can contain spaces and parentheses
+            std::size_t nameStart = line.find('(');
+            std::size_t nameEnd = line.rfind(')');
+            if (nameStart == std::string::npos || nameEnd == std::string::npos || nameEnd < nameStart)
+                continue;
+
+            auto const& fields = Acore::Tokenize(std::string_view(line).substr(nameEnd + 2), ' ', false);
+            if (fields.size() < 13)
+                continue;
+
+            ThreadStat& stat = stats[*tid];
+            stat.Name = line.substr(nameStart + 1, nameEnd - nameStart - 1);
+            stat.Ticks = Acore::StringTo<uint64>(fields[11]).value_or(0) + Acore::StringTo<uint64>(fields[12]).value_or(0);
+        }
+#endif
+
+        return stats;
+    }
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    struct CounterEvent
+    {
+        char const* Name;
+        uint32 Type;
+        uint64 Config;
+        uint64 SASCounterValues::* Value;
+    };
+
+    constexpr uint64 CACHE_READ_MISS = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    // Same order as SASCounterValues
+    constexpr std::array<CounterEvent, 4> CounterEvents =
+    {{
+        { "cycles",       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,                    &SASCounterValues::Cycles },
+        { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,                  &SASCounterValues::Instructions },
+        { "LLC misses",   PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | CACHE_READ_MISS,   &SASCounterValues::CacheMisses },
+        { "dTLB misses",  PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | CACHE_READ_MISS, &SASCounterValues::TlbMisses }
+    }};
+
+    // Scaled by the time it was actually counted, the pmu is shared with other events
+    uint64 ReadCounter(int fd)
+    {
+        uint64 values[3] = {};  // Value, time enabled, time running
+        if (fd < 0 || read(fd, values, sizeof(values)) != sizeof(values) || !values[2])
+            return 0;
+
+        return values[2] < values[1] ? uint64(double(values[0]) * values[1] / values[2]) : values[0];
+    }
+#endif
+
+    // Per thousand instructions
+    float GetPerKilo(uint64 count, uint64 instructions)
+    {
+        return instructions ? count * 1000.0f / instructions : 0.0f;
+    }
+
+    // Read from the sampler thread, the start time never changes
+    uint32 GetUptimeHour()
+    {
+        return static_cast<uint32>((time(nullptr) - GameTime::GetStartTime().count()) / HOUR);
+    }
+}
+
+/*static*/ ServerAutoShutdownSampler* ServerAutoShutdownSampler::instance()
+{
+    static ServerAutoShutdownSampler instance;
+    return &instance;
+}
+
+ServerAutoShutdownSampler::~ServerAutoShutdownSampler()
+{
+    Stop();
+}
+
+void ServerAutoShutdownSampler::Start(uint32 intervalSeconds)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _intervalSeconds = intervalSeconds;
+    }
+
+    if (_thread.joinable())
+    {
+        _condition.notify_one();
+        return;
+    }
+
+    _isStopping = false;
+    _thread = std::thread(&ServerAutoShutdownSampler::Run, this);
+}
+
+void ServerAutoShutdownSampler::Stop()
+{
+    SetCountersEnabled(false);
+
+    if (!_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isStopping = true;
+    }
+
+    _condition.notify_one();
+    _thread.join();
+}
+
+void ServerAutoShutdownSampler::SetCountersEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!enabled)
+    {
+        CloseCounters();
+        return;
+    }
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    pid_t tid = pid_t(syscall(SYS_gettid));
+
+    for (std::size_t i = 0; i < CounterEvents.size(); ++i)
+    {
+        // Already counting, only the ones which failed before are opened again
+        if (_counterFds[i] >= 0)
+            continue;
+
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = CounterEvents[i].Type;
+        attr.config = CounterEvents[i].Config;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // Each on its own, a counter the cpu doesn't have (or a vm without pmu) leaves the others
+        _counterFds[i] = int(syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (_counterFds[i] < 0)
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: Can't open the {} counter ({}), not in the cpu or denied by kernel.perf_event_paranoid", CounterEvents[i].Name, std::strerror(errno));
+            continue;
+        }
+
+        // A new counter starts from zero
+        _lastCounters.*CounterEvents[i].Value = 0;
+    }
+#else
+    LOG_WARN("module", "> ServerAutoShutdown: Hardware counters are only supported on Linux");
+#endif
+}
+
+void ServerAutoShutdownSampler::CloseCounters()
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    for (int& fd : _counterFds)
+    {
+        if (fd >= 0)
+            close(fd);
+
+        fd = -1;
+    }
+#endif
+}
+
+void ServerAutoShutdownSampler::Run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (!_isStopping)
+    {
+        // Woken up early by a new interval or the stop
+        uint32 intervalSeconds = _intervalSeconds;
+        if (_condition.wait_for(lock, Seconds(intervalSeconds), [this, intervalSeconds] { return _isStopping || _intervalSeconds != intervalSeconds; }))
+            continue;
+
+        lock.unlock();
+        Sample();
+        lock.lock();
+    }
+}
+
+void ServerAutoShutdownSampler::Sample()
+{
+    SASCostScope costScope(SAS_COST_SAMPLER);
+
+    // One snapshot for the whole sample, a reload meanwhile is seen by the next one
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+
+    uint32 uptimeHour = GetUptimeHour();
+
+    SampleMemory(*settings, uptimeHour);
+    SampleThreads(*settings);
+    SampleCounters(uptimeHour);
+}
+
+void ServerAutoShutdownSampler::SampleCounters(uint32 uptimeHour)
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_counterFds[0] < 0 && _counterFds[1] < 0)
+        return;
+
+    // Totals since the counters were opened
+    SASCounterValues total;
+    total.Cycles = ReadCounter(_counterFds[0]);
+    total.Instructions = ReadCounter(_counterFds[1]);
+    total.CacheMisses = ReadCounter(_counterFds[2]);
+    total.TlbMisses = ReadCounter(_counterFds[3]);
+
+    // The scaling of a multiplexed counter can make its total go back a little
+    auto GetDelta = [](uint64 current, uint64 last) { return current > last ? current - last : 0; };
+
+    if (_counterHours.empty() || _counterHours.back().UptimeHour != uptimeHour)
+    {
+        // The previous hour is complete
+        if (!_counterHours.empty())
+        {
+            CounterHourInfo const& info = _counterHours.back();
+            LOG_INFO("module", "> ServerAutoShutdown: Uptime {}h - world thread IPC {:.2f}, LLC misses {:.2f}, dTLB misses {:.2f} per 1000 instructions",
+                info.UptimeHour, info.Values.Cycles ? float(info.Values.Instructions) / info.Values.Cycles : 0.0f,
+                GetPerKilo(info.Values.CacheMisses, info.Values.Instructions), GetPerKilo(info.Values.TlbMisses, info.Values.Instructions));
+        }
+
+        if (_counterHours.size() >= MAX_MEMORY_HOURS)
+            _counterHours.erase(_counterHours.begin());
+
+        _counterHours.push_back({ uptimeHour, SASCounterValues() });
+    }
+
+    SASCounterValues& values = _counterHours.back().Values;
+    values.Cycles += GetDelta(total.Cycles, _lastCounters.Cycles);
+    values.Instructions += GetDelta(total.Instructions, _lastCounters.Instructions);
+    values.CacheMisses += GetDelta(total.CacheMisses, _lastCounters.CacheMisses);
+    values.TlbMisses += GetDelta(total.TlbMisses, _lastCounters.TlbMisses);
+
+    _lastCounters = total;
+#else
+    (void)uptimeHour;
+#endif
+}
+
+void ServerAutoShutdownSampler::SampleMemory(SASSettings const& settings, uint32 uptimeHour)
+{
+    uint64 rss = 0;
+    SASMemoryBreakdown breakdown;
+
+    if (!GetMemoryBreakdown(rss, breakdown))
+        rss = GetResidentSize();
+
+    if (!rss)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_memoryHours.empty() || _memoryHours.back().UptimeHour != uptimeHour)
+    {
+        // The previous hour is complete
+        if (!_memoryHours.empty())
+        {
+            MemoryHourInfo const& info = _memoryHours.back();
+            LOG_INFO("module", "> ServerAutoShutdown: Uptime {}h - RSS {} MB (min {}, max {}), allocator {} profile '{}'",
+                info.UptimeHour, info.LastRss >> 20, info.MinRss >> 20, info.MaxRss >> 20, ServerAutoShutdownAllocator::GetName(), settings.AllocatorProfile);
+            LOG_INFO("module", "> ServerAutoShutdown: Uptime {}h - anonymous {} MB, file {} MB, shmem {} MB, swap {} MB, dirty {} MB, clean {} MB",
+                info.UptimeHour, info.Last.Anonymous >> 20, info.Last.File >> 20, info.Last.Shmem >> 20, info.Last.Swap >> 20, info.Last.Dirty >> 20, info.Last.Clean >> 20);
+        }
+
+        if (_memoryHours.size() >= MAX_MEMORY_HOURS)
+            _memoryHours.erase(_memoryHours.begin());
+
+        _memoryHours.push_back({ uptimeHour, rss, rss, rss, breakdown });
+    }
+    else
+    {
+        MemoryHourInfo& info = _memoryHours.back();
+        info.MinRss = std::min(info.MinRss, rss);
+        info.MaxRss = std::max(info.MaxRss, rss);
+        info.LastRss = rss;
+        info.Last = breakdown;
+    }
+
+    CheckAnonymousGrowth(settings, uptimeHour, breakdown.Anonymous);
+}
+
+void ServerAutoShutdownSampler::CheckAnonymousGrowth(SASSettings const& settings, uint32 uptimeHour, uint64 anonymous)
+{
+    uint64 growthLimit = uint64(settings.MemoryAnonymousGrowthMB) << 20;
+
+    // Only the heap growth, file mappings are page cache the kernel reclaims anyway
+    if (!growthLimit || !anonymous || uptimeHour < settings.MemoryBaselineHour || _isAnonymousGrowthReported)
+        return;
+
+    // Once the world is warm, loaded grids and caches are not growth
+    if (!_anonymousBaseline)
+    {
+        _anonymousBaseline = anonymous;
+        LOG_INFO("module", "> ServerAutoShutdown: Anonymous memory baseline {} MB", anonymous >> 20);
+        return;
+    }
+
+    if (anonymous < _anonymousBaseline + growthLimit)
+        return;
+
+    _isAnonymousGrowthReported = true;
+    sSAS->ReportHealth(Acore::StringFormatFmt("anonymous memory grew by {} MB since uptime {}h ({} MB)",
+        (anonymous - _anonymousBaseline) >> 20, settings.MemoryBaselineHour, anonymous >> 20));
+}
+
+void ServerAutoShutdownSampler::SampleThreads(SASSettings const& settings)
+{
+    std::size_t threadWindow = settings.ThreadsWindow;
+    if (!threadWindow)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    auto const& stats = GetThreadStats();
+
+#if AC_PLATFORM != AC_PLATFORM_WINDOWS
+    float ticksPerSecond = float(sysconf(_SC_CLK_TCK));
+#else
+    float ticksPerSecond = 100.0f;
+#endif
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    float elapsed = std::chrono::duration<float>(now - _threadSampleTime).count();
+    bool hasPrevious = !_threadTicks.empty() && elapsed > 0.0f;
+
+    // Busy fraction of every thread seen in both samples, grouped by name
+    std::map<std::string, std::vector<float>> groups;
+    for (auto const& [tid, stat] : stats)
+    {
+        auto itr = _threadTicks.find(tid);
+        if (hasPrevious && itr != _threadTicks.end() && stat.Ticks >= itr->second)
+            groups[stat.Name].emplace_back(float(stat.Ticks - itr->second) / ticksPerSecond / elapsed);
+    }
+
+    _threadTicks.clear();
+    for (auto const& [tid, stat] : stats)
+        _threadTicks[tid] = stat.Ticks;
+
+    _threadSampleTime = now;
+
+    if (groups.empty())
+        return;
+
+    std::map<std::string, ThreadGroupSample> sample;
+    for (auto const& [name, busy] : groups)
+    {
+        float total = 0.0f;
+        float busiest = 0.0f;
+
+        for (float value : busy)
+        {
+            total += value;
+            busiest = std::max(busiest, value);
+        }
+
+        ThreadGroupSample& group = sample[name];
+        group.Threads = uint32(busy.size());
+        group.Utilisation = total / busy.size();
+        group.Imbalance = group.Utilisation > 0.0f ? busiest / group.Utilisation : 1.0f;
+        group.Busiest = busiest;
+    }
+
+    _threadSamples.emplace_back(std::move(sample));
+    while (_threadSamples.size() > threadWindow)
+        _threadSamples.pop_front();
+
+    // Log every full window
+    if (++_threadSamplesSinceLog >= threadWindow)
+    {
+        _threadSamplesSinceLog = 0;
+
+        for (auto const& [name, group] : _threadSamples.back())
+        {
+            ThreadGroupSample average = GetThreadGroupAverage(name);
+            LOG_INFO("module", "> ServerAutoShutdown: Threads '{}' x{} - {:.1f}% busy, busiest {:.1f}%, imbalance {:.2f}", name, average.Threads,
+                average.Utilisation * 100.0f, average.Busiest * 100.0f, average.Imbalance);
+        }
+    }
+
+    // A full window with a thread of the group saturated, the slowdown is cpu bound there. Not the group
+    // average, the unnamed map updaters share the process name with the world thread and the mostly idle
+    // database and network threads, which would dilute it
+    std::string const& saturationGroup = settings.ThreadsSaturationGroup;
+    float saturationLimit = settings.ThreadsSaturationPercent / 100.0f;
+
+    if (saturationLimit > 0.0f && _threadSamples.size() == threadWindow)
+    {
+        bool saturated = std::all_of(_threadSamples.begin(), _threadSamples.end(), [&saturationGroup, saturationLimit](auto const& threadSample)
+        {
+            auto itr = threadSample.find(saturationGroup);
+            return itr != threadSample.end() && itr->second.Busiest >= saturationLimit;
+        });
+
+        if (saturated)
+        {
+            ThreadGroupSample average = GetThreadGroupAverage(saturationGroup);
+            sSAS->ReportHealth(Acore::StringFormatFmt("threads '{}' saturated, busiest {:.0f}% busy over {} samples (group {:.0f}%, imbalance {:.2f})",
+                saturationGroup, average.Busiest * 100.0f, threadWindow, average.Utilisation * 100.0f, average.Imbalance));
+            _threadSamples.clear();
+        }
+    }
+}
+
+ServerAutoShutdownSampler::ThreadGroupSample ServerAutoShutdownSampler::GetThreadGroupAverage(std::string const& name) const
+{
+    ThreadGroupSample average;
+    uint32 count = 0;
+
+    for (auto const& sample : _threadSamples)
+    {
+        auto itr = sample.find(name);
+        if (itr == sample.end())
+            continue;
+
+        average.Threads = std::max(average.Threads, itr->second.Threads);
+        average.Utilisation += itr->second.Utilisation;
+        average.Imbalance += itr->second.Imbalance;
+        average.Busiest += itr->second.Busiest;
+        ++count;
+    }
+
+    if (count)
+    {
+        average.Utilisation /= count;
+        average.Imbalance /= count;
+        average.Busiest /= count;
+    }
+
+    return average;
+}
+
+std::vector<std::string> ServerAutoShutdownSampler::GetThreadReport() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> report;
+
+    if (_threadSamples.empty())
+        return report;
+
+    for (auto const& [name, sample] : _threadSamples.back())
+    {
+        ThreadGroupSample average = GetThreadGroupAverage(name);
+        report.emplace_back(Acore::StringFormatFmt("Threads '{}' x{} - {:.1f}% busy (window {:.1f}%), busiest {:.1f}% (window {:.1f}%), imbalance {:.2f} (window {:.2f})",
+            name, sample.Threads, sample.Utilisation * 100.0f, average.Utilisation * 100.0f, sample.Busiest * 100.0f, average.Busiest * 100.0f,
+            sample.Imbalance, average.Imbalance));
+    }
+
+    return report;
+}
+
+std::vector<std::string> ServerAutoShutdownSampler::GetReport() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> report;
+
+    report.emplace_back(Acore::StringFormatFmt("Allocator {}, profile '{}'", ServerAutoShutdownAllocator::GetName(), ServerAutoShutdownSettings::Get()->AllocatorProfile));
+
+    // Last day only, the log has the full curve
+    std::size_t first = _memoryHours.size() > 24 ? _memoryHours.size() - 24 : 0;
+    for (std::size_t i = first; i < _memoryHours.size(); ++i)
+    {
+        MemoryHourInfo const& info = _memoryHours[i];
+        report.emplace_back(Acore::StringFormatFmt("Uptime {}h - RSS {} MB (min {}, max {}), anonymous {} MB, file {} MB, shmem {} MB, swap {} MB",
+            info.UptimeHour, info.LastRss >> 20, info.MinRss >> 20, info.MaxRss >> 20, info.Last.Anonymous >> 20, info.Last.File >> 20, info.Last.Shmem >> 20, info.Last.Swap >> 20));
+    }
+
+    first = _counterHours.size() > 24 ? _counterHours.size() - 24 : 0;
+    for (std::size_t i = first; i < _counterHours.size(); ++i)
+    {
+        SASCounterValues const& values = _counterHours[i].Values;
+        report.emplace_back(Acore::StringFormatFmt("Uptime {}h - IPC {:.2f}, LLC misses {:.2f}, dTLB misses {:.2f} per 1000 instructions",
+            _counterHours[i].UptimeHour, values.Cycles ? float(values.Instructions) / values.Cycles : 0.0f,
+            GetPerKilo(values.CacheMisses, values.Instructions), GetPerKilo(values.TlbMisses, values.Instructions)));
+    }
+
+    return report;
+}
@@ -0,0 +1,132 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SERVER_AUTO_SHUTDOWN_SAMPLER_H_
+#define _SERVER_AUTO_SHUTDOWN_SAMPLER_H_
+
+#include "Common.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct SASSettings;
+
+// Bytes of every kind of mapping, /proc/self/smaps_rollup
+struct SASMemoryBreakdown
+{
+    uint64 Anonymous = 0;  // Heap and stacks, only freed by the process
+    uint64 File = 0;       // Binary, libraries and mapped data, reclaimable by the kernel
+    uint64 Shmem = 0;
+    uint64 Swap = 0;
+    uint64 Dirty = 0;
+    uint64 Clean = 0;
+};
+
+// Hardware counters of the world thread (perf_event_open), user space only
+struct SASCounterValues
+{
+    uint64 Cycles = 0;
+    uint64 Instructions = 0;
+    uint64 CacheMisses = 0;  // Last level cache loads
+    uint64 TlbMisses = 0;    // Data TLB loads
+};
+
+// Background thread for the process measures, away from the world update
+class ServerAutoShutdownSampler
+{
+public:
+    static ServerAutoShutdownSampler* instance();
+
+    ~ServerAutoShutdownSampler();
+
+    // Start the thread, or change its interval if it's already running
+    void Start(uint32 intervalSeconds);
+    void Stop();
+
+    // Open the counters on the calling thread (the world thread), or close them
+    void SetCountersEnabled(bool enabled);
+
+    std::vector<std::string> GetReport() const;
+    std::vector<std::string> GetThreadReport() const;
+
+private:
+    struct MemoryHourInfo
+    {
+        uint32 UptimeHour = 0;
+        uint64 MinRss = 0;
+        uint64 MaxRss = 0;
+        uint64 LastRss = 0;
+        SASMemoryBreakdown Last;
+    };
+
+    struct CounterHourInfo
+    {
+        uint32 UptimeHour = 0;
+        SASCounterValues Values;
+    };
+
+    // Cpu use of the threads with the same name, over one sample
+    struct ThreadGroupSample
+    {
+        uint32 Threads = 0;
+        float Utilisation = 0.0f;  // Of the group capacity, 1.0 - every thread always busy
+        float Imbalance = 0.0f;    // Busiest thread over the group average
+        float Busiest = 0.0f;      // Of one thread, 1.0 - always busy
+    };
+
+    void Run();
+    void Sample();
+    void SampleMemory(SASSettings const& settings, uint32 uptimeHour);
+    void CheckAnonymousGrowth(SASSettings const& settings, uint32 uptimeHour, uint64 anonymous);
+    void SampleThreads(SASSettings const& settings);
+    void SampleCounters(uint32 uptimeHour);
+    void CloseCounters();
+
+    // Average of the group over the rolling window
+    ThreadGroupSample GetThreadGroupAverage(std::string const& name) const;
+
+    std::thread _thread;
+    mutable std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _isStopping = false;
+    uint32 _intervalSeconds = 0;
+
+    std::vector<MemoryHourInfo> _memoryHours;
+
+    uint64 _anonymousBaseline = 0;
+    bool _isAnonymousGrowthReported = false;
+
+    std::array<int, 4> _counterFds = { -1, -1, -1, -1 };  // Same order as SASCounterValues
+    SASCounterValues _lastCounters;
+    std::vector<CounterHourInfo> _counterHours;
+
+    std::unordered_map<uint32, uint64> _threadTicks;  // Thread id - cpu clock ticks
+    std::chrono::steady_clock::time_point _threadSampleTime;
+    std::deque<std::map<std::string, ThreadGroupSample>> _threadSamples;
+    uint32 _threadSamplesSinceLog = 0;
+};
+
+#define sSASSampler ServerAutoShutdownSampler::instance()
+
+#endif /* _SERVER_AUTO_SHUTDOWN_SAMPLER_H_ */
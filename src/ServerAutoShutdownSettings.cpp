@@ -0,0 +1,223 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServerAutoShutdownSettings.h"
+#include "ServerAutoShutdown.h"
+#include "Config.h"
+#include "Log.h"
+#include "StringConvert.h"
+#include "Tokenize.h"
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    // Replaced as a whole, only through std::atomic_load and std::atomic_store
+    std::shared_ptr<SASSettings const> settings = std::make_shared<SASSettings const>();
+
+    // Time (in HH:MM:SS) of a config option
+    Optional<SASTimeOfDay> ParseConfigTime(std::string const& option, std::string const& defaultTime)
+    {
+        std::string configTime = sConfigMgr->GetOption<std::string>(option, defaultTime);
+        auto const& tokens = Acore::Tokenize(configTime, ':', false);
+
+        if (tokens.size() != 3)
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: Incorrect time in config option '{}' - '{}'", option, configTime);
+            return std::nullopt;
+        }
+
+        // Check convert to int
+        for (auto const& token : tokens)
+        {
+            if (!Acore::StringTo<uint8>(token))
+            {
+                LOG_ERROR("module", "> ServerAutoShutdown: Incorrect time in config option '{}' - '{}'", option, configTime);
+                return std::nullopt;
+            }
+        }
+
+        SASTimeOfDay time;
+        time.Hour = *Acore::StringTo<uint8>(tokens.at(0));
+        time.Minute = *Acore::StringTo<uint8>(tokens.at(1));
+        time.Second = *Acore::StringTo<uint8>(tokens.at(2));
+
+        if (time.Hour > 23)
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: Incorrect hour in config option '{}' - '{}'", option, configTime);
+            return std::nullopt;
+        }
+        else if (time.Minute >= 60)
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: Incorrect minute in config option '{}' - '{}'", option, configTime);
+            return std::nullopt;
+        }
+        else if (time.Second >= 60)
+        {
+            LOG_ERROR("module", "> ServerAutoShutdown: Incorrect second in config option '{}' - '{}'", option, configTime);
+            return std::nullopt;
+        }
+
+        return time;
+    }
+
+    // Empty option - keep the allocator default
+    Optional<int64> GetAllocatorOption(std::string const& name)
+    {
+        std::string value = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Allocator." + name, "");
+        if (value.empty())
+            return std::nullopt;
+
+        Optional<int64> number = Acore::StringTo<int64>(value);
+        if (!number)
+            LOG_ERROR("module", "> ServerAutoShutdown: Incorrect value in config option 'ServerAutoShutdown.Allocator.{}' - '{}'", name, value);
+
+        return number;
+    }
+}
+
+void ServerAutoShutdownSettings::Load()
+{
+    auto loaded = std::make_shared<SASSettings>();
+
+    loaded->Enabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Enabled", false);
+    loaded->EveryDays = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.EveryDays", 1);
+    loaded->Time = ParseConfigTime("ServerAutoShutdown.Time", "04:00:00");
+    loaded->PreAnnounceSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.PreAnnounce.Seconds", 3600);
+    loaded->PreAnnounceMessage = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.PreAnnounce.Message", "[SERVER]: Automated (quick) server restart in %s");
+    loaded->StartEvents = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.StartEvents", "");
+
+    loaded->AlignToResetMask = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.AlignToReset.Mask", 0);
+    loaded->AlignToResetLeadSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.AlignToReset.LeadSeconds", 300);
+
+    loaded->SoftEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Soft.Enabled", false);
+    loaded->SoftEveryDays = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Soft.EveryDays", 1);
+    loaded->SoftTime = ParseConfigTime("ServerAutoShutdown.Soft.Time", "16:00:00");
+    loaded->SoftActions = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Soft.Actions", SAS_SOFT_ALL);
+    loaded->SoftPreAnnounceSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Soft.PreAnnounce.Seconds", 0);
+    loaded->SoftPreAnnounceMessage = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Soft.PreAnnounce.Message", "[SERVER]: Automated maintenance in %s, expect a short lag");
+
+    loaded->HealthAllowRestart = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Health.AllowRestart", false);
+    loaded->HealthDumpEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Health.Dump.Enabled", false);
+    loaded->HealthDumpDirectory = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Health.Dump.Directory", "");
+    loaded->HealthDumpFilter = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Health.Dump.Filter", "");
+    loaded->HealthProfileEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Health.Profile.Enabled", false);
+    loaded->HealthProfileSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Health.Profile.Seconds", 300);
+    loaded->HealthProfileFrequency = std::clamp<uint32>(sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Health.Profile.Frequency", 49), 1, 1000);
+    loaded->HealthProfileThreads = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Health.Profile.Threads", "worldserver");
+    loaded->HealthProfileDirectory = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Health.Profile.Directory", "");
+
+    loaded->SelfCostEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.SelfCost.Enabled", false);
+    loaded->SelfCostLogInterval = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.SelfCost.LogInterval", 0);
+
+    loaded->BufferPoolEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.BufferPool.Enabled", false);
+    loaded->BufferPoolDatabase = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.BufferPool.Database", "Character");
+    loaded->BufferPoolDumpBeforeSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.BufferPool.DumpBeforeSeconds", 60);
+    loaded->BufferPoolHoldFraction = sConfigMgr->GetOption<float>("ServerAutoShutdown.BufferPool.HoldFraction", 0.0f);
+    loaded->BufferPoolHoldTimeout = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.BufferPool.HoldTimeout", 300);
+    loaded->BufferPoolPollSeconds = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("ServerAutoShutdown.BufferPool.PollSeconds", 5));
+
+    loaded->CheckpointMarkerFile = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Checkpoint.MarkerFile", "");
+    loaded->CheckpointHoldSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Checkpoint.HoldSeconds", 0);
+
+    loaded->MapHealthInterval = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.MapHealth.Interval", 0);
+    loaded->MapHealthMaxObjects = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.MapHealth.MaxObjects", 0);
+    loaded->MapHealthPolicy = sConfigMgr->GetOption<uint8>("ServerAutoShutdown.MapHealth.Policy", SAS_MAP_POLICY_LOG);
+    loaded->MapHealthWarnSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.MapHealth.WarnSeconds", 60);
+    loaded->MapHealthCooldownSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.MapHealth.CooldownSeconds", 3600);
+    loaded->MapHealthMessage = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.MapHealth.Message", "[SERVER]: This area will be reloaded in %s, you will be moved to your home");
+
+    loaded->DatabaseHealthInterval = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.DatabaseHealth.Interval", 0);
+    loaded->DatabaseHealthWindow = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("ServerAutoShutdown.DatabaseHealth.Window", 60));
+    loaded->DatabaseHealthMaxP95 = sConfigMgr->GetOption<float>("ServerAutoShutdown.DatabaseHealth.MaxP95", 0.0f);
+    loaded->DatabaseHealthCooldownSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.DatabaseHealth.CooldownSeconds", 3600);
+
+    loaded->ContentGateSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.ContentGate.Seconds", 0);
+    loaded->ContentGateMessage = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.ContentGate.Message", "[SERVER]: Queues are closed until the server restart");
+
+    loaded->ProgressiveUnloadSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.ProgressiveUnload.Seconds", 0);
+    loaded->ProgressiveUnloadBudgetMs = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.ProgressiveUnload.BudgetMs", 5);
+    loaded->ProgressiveUnloadPassSeconds = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("ServerAutoShutdown.ProgressiveUnload.PassSeconds", 10));
+
+    loaded->LogRotateSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.LogRotate.Seconds", 0);
+    loaded->LogRotateCompressor = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.LogRotate.Compressor", "zstd -q --rm");
+    loaded->LogRotateMaxSizeMB = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.LogRotate.MaxSizeMB", 0);
+
+    loaded->RealmStatusEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.RealmStatus.Enabled", false);
+    loaded->RealmStatusOfflineSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.RealmStatus.OfflineSeconds", 30);
+
+    loaded->SamplerInterval = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Sampler.Interval", 0);
+    loaded->MemoryAnonymousGrowthMB = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Memory.AnonymousGrowthMB", 0);
+    loaded->MemoryBaselineHour = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Memory.BaselineHour", 1);
+    loaded->CountersEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Counters.Enabled", false);
+
+    loaded->AllocatorProfile = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Allocator.Profile", "");
+    loaded->AllocatorArenaMax = GetAllocatorOption("ArenaMax");
+    loaded->AllocatorTrimThreshold = GetAllocatorOption("TrimThreshold");
+    loaded->AllocatorBackgroundThread = GetAllocatorOption("BackgroundThread");
+    loaded->AllocatorDirtyDecayMs = GetAllocatorOption("DirtyDecayMs");
+    loaded->AllocatorMuzzyDecayMs = GetAllocatorOption("MuzzyDecayMs");
+    loaded->AllocatorNArenas = GetAllocatorOption("NArenas");
+
+    loaded->ThreadsWindow = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Threads.Window", 0);
+    loaded->ThreadsSaturationGroup = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Threads.SaturationGroup", "worldserver");
+    loaded->ThreadsSaturationPercent = sConfigMgr->GetOption<float>("ServerAutoShutdown.Threads.SaturationPercent", 0.0f);
+
+    loaded->WriteProfileSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.WriteProfile.Seconds", 0);
+    loaded->WriteProfileFile = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.WriteProfile.File", "");
+
+    loaded->TimelineFile = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Timeline.File", "");
+
+    loaded->SaveBenchEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.SaveBench.Enabled", false);
+    loaded->SaveBenchPayloadBytes = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.SaveBench.PayloadBytes", 256);
+
+    loaded->DeployEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Deploy.Enabled", false);
+    loaded->DeployWatchDirs = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Deploy.WatchDirs", "");
+    loaded->DeployStableSeconds = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Deploy.StableSeconds", 30));
+    loaded->DeployWindowStart = ParseConfigTime("ServerAutoShutdown.Deploy.WindowStart", "03:00:00");
+    loaded->DeployWindowEnd = ParseConfigTime("ServerAutoShutdown.Deploy.WindowEnd", "07:00:00");
+    loaded->DeployMaxPlayers = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Deploy.MaxPlayers", 50);
+
+    loaded->LeaseEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Lease.Enabled", false);
+    loaded->LeaseDatabase = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Lease.Database", "Character");
+    loaded->LeaseTable = sConfigMgr->GetOption<std::string>("ServerAutoShutdown.Lease.Table", "mod_server_auto_shutdown_restart_lease");
+    loaded->LeaseSlots = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Lease.Slots", 1));
+    loaded->LeaseSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Lease.Seconds", 900);
+    loaded->LeaseHeartbeatSeconds = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Lease.HeartbeatSeconds", 30));
+    loaded->LeaseBeforeSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Lease.BeforeSeconds", 60);
+    loaded->LeaseMaxWaitSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Lease.MaxWaitSeconds", 1800);
+
+    loaded->WatchdogSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Watchdog.Seconds", 0);
+    loaded->AdmissionMaxHoldSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Admission.MaxHoldSeconds", 0);
+
+    loaded->FaultEnabled = sConfigMgr->GetOption<bool>("ServerAutoShutdown.Fault.Enabled", false);
+    loaded->FaultWindowSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Fault.WindowSeconds", 60);
+    loaded->FaultSlowCommitChance = sConfigMgr->GetOption<float>("ServerAutoShutdown.Fault.SlowCommit.Chance", 0.0f);
+    loaded->FaultSlowCommitMilliseconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Fault.SlowCommit.Milliseconds", 5000);
+    loaded->FaultStallChance = sConfigMgr->GetOption<float>("ServerAutoShutdown.Fault.Stall.Chance", 0.0f);
+    loaded->FaultStallMilliseconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Fault.Stall.Milliseconds", 2000);
+    loaded->FaultVetoChance = sConfigMgr->GetOption<float>("ServerAutoShutdown.Fault.Veto.Chance", 0.0f);
+    loaded->FaultHungTeardownChance = sConfigMgr->GetOption<float>("ServerAutoShutdown.Fault.HungTeardown.Chance", 0.0f);
+    loaded->FaultHungTeardownSeconds = sConfigMgr->GetOption<uint32>("ServerAutoShutdown.Fault.HungTeardown.Seconds", 600);
+
+    std::atomic_store(&settings, std::shared_ptr<SASSettings const>(std::move(loaded)));
+}
+
+std::shared_ptr<SASSettings const> ServerAutoShutdownSettings::Get()
+{
+    return std::atomic_load(&settings);
+}
@@ -0,0 +1,168 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SERVER_AUTO_SHUTDOWN_SETTINGS_H_
+#define _SERVER_AUTO_SHUTDOWN_SETTINGS_H_
+
+#include "Common.h"
+#include "Optional.h"
+#include <memory>
+#include <string>
+
+struct SASTimeOfDay
+{
+    uint8 Hour = 0;
+    uint8 Minute = 0;
+    uint8 Second = 0;
+
+    uint32 GetDaySeconds() const { return Hour * HOUR + Minute * MINUTE + Second; }
+};
+
+// Every 'ServerAutoShutdown.*' option, never changed once published
+struct SASSettings
+{
+    bool Enabled = false;
+    uint32 EveryDays = 1;
+    Optional<SASTimeOfDay> Time;  // Empty if the option is incorrect
+    uint32 PreAnnounceSeconds = 3600;
+    std::string PreAnnounceMessage = "[SERVER]: Automated (quick) server restart in %s";
+    std::string StartEvents;
+
+    uint32 AlignToResetMask = 0;
+    uint32 AlignToResetLeadSeconds = 300;
+
+    bool SoftEnabled = false;
+    uint32 SoftEveryDays = 1;
+    Optional<SASTimeOfDay> SoftTime;
+    uint32 SoftActions = 0;
+    uint32 SoftPreAnnounceSeconds = 0;
+    std::string SoftPreAnnounceMessage = "[SERVER]: Automated maintenance in %s, expect a short lag";
+
+    bool HealthAllowRestart = false;
+    bool HealthDumpEnabled = false;
+    std::string HealthDumpDirectory;
+    std::string HealthDumpFilter;
+    bool HealthProfileEnabled = false;
+    uint32 HealthProfileSeconds = 300;
+    uint32 HealthProfileFrequency = 49;
+    std::string HealthProfileThreads = "worldserver";
+    std::string HealthProfileDirectory;
+
+    bool SelfCostEnabled = false;
+    uint32 SelfCostLogInterval = 0;
+
+    bool BufferPoolEnabled = false;
+    std::string BufferPoolDatabase = "Character";
+    uint32 BufferPoolDumpBeforeSeconds = 60;
+    float BufferPoolHoldFraction = 0.0f;
+    uint32 BufferPoolHoldTimeout = 300;
+    uint32 BufferPoolPollSeconds = 5;
+
+    std::string CheckpointMarkerFile;
+    uint32 CheckpointHoldSeconds = 0;
+
+    uint32 MapHealthInterval = 0;
+    uint32 MapHealthMaxObjects = 0;
+    uint8 MapHealthPolicy = 0;
+    uint32 MapHealthWarnSeconds = 60;
+    uint32 MapHealthCooldownSeconds = 3600;
+    std::string MapHealthMessage = "[SERVER]: This area will be reloaded in %s, you will be moved to your home";
+
+    uint32 DatabaseHealthInterval = 0;
+    uint32 DatabaseHealthWindow = 60;
+    float DatabaseHealthMaxP95 = 0.0f;
+    uint32 DatabaseHealthCooldownSeconds = 3600;
+
+    uint32 ContentGateSeconds = 0;
+    std::string ContentGateMessage = "[SERVER]: Queues are closed until the server restart";
+
+    uint32 ProgressiveUnloadSeconds = 0;
+    uint32 ProgressiveUnloadBudgetMs = 5;
+    uint32 ProgressiveUnloadPassSeconds = 10;
+
+    uint32 LogRotateSeconds = 0;
+    std::string LogRotateCompressor = "zstd -q --rm";
+    uint32 LogRotateMaxSizeMB = 0;
+
+    bool RealmStatusEnabled = false;
+    uint32 RealmStatusOfflineSeconds = 30;
+
+    uint32 SamplerInterval = 0;
+    uint32 MemoryAnonymousGrowthMB = 0;
+    uint32 MemoryBaselineHour = 1;
+    bool CountersEnabled = false;
+
+    // Empty - keep the allocator default
+    std::string AllocatorProfile;
+    Optional<int64> AllocatorArenaMax;
+    Optional<int64> AllocatorTrimThreshold;
+    Optional<int64> AllocatorBackgroundThread;
+    Optional<int64> AllocatorDirtyDecayMs;
+    Optional<int64> AllocatorMuzzyDecayMs;
+    Optional<int64> AllocatorNArenas;
+
+    uint32 ThreadsWindow = 0;
+    std::string ThreadsSaturationGroup = "worldserver";
+    float ThreadsSaturationPercent = 0.0f;
+
+    uint32 WriteProfileSeconds = 0;
+    std::string WriteProfileFile;
+
+    std::string TimelineFile;
+
+    bool SaveBenchEnabled = false;
+    uint32 SaveBenchPayloadBytes = 256;
+
+    bool DeployEnabled = false;
+    std::string DeployWatchDirs;
+    uint32 DeployStableSeconds = 30;
+    Optional<SASTimeOfDay> DeployWindowStart;
+    Optional<SASTimeOfDay> DeployWindowEnd;
+    uint32 DeployMaxPlayers = 50;
+
+    bool LeaseEnabled = false;
+    std::string LeaseDatabase = "Character";
+    std::string LeaseTable = "mod_server_auto_shutdown_restart_lease";
+    uint32 LeaseSlots = 1;
+    uint32 LeaseSeconds = 900;
+    uint32 LeaseHeartbeatSeconds = 30;
+    uint32 LeaseBeforeSeconds = 60;
+    uint32 LeaseMaxWaitSeconds = 1800;
+
+    uint32 WatchdogSeconds = 0;
+    uint32 AdmissionMaxHoldSeconds = 0;
+
+    bool FaultEnabled = false;
+    uint32 FaultWindowSeconds = 60;
+    float FaultSlowCommitChance = 0.0f;
+    uint32 FaultSlowCommitMilliseconds = 5000;
+    float FaultStallChance = 0.0f;
+    uint32 FaultStallMilliseconds = 2000;
+    float FaultVetoChance = 0.0f;
+    float FaultHungTeardownChance = 0.0f;
+    uint32 FaultHungTeardownSeconds = 600;
+};
+
+// The world thread parses the config into a new snapshot on every load, every thread reads the
+// current one without a lock. A reader keeps its snapshot alive as long as it holds the pointer
+namespace ServerAutoShutdownSettings
+{
+    void Load();
+    std::shared_ptr<SASSettings const> Get();
+}
+
+#endif /* _SERVER_AUTO_SHUTDOWN_SETTINGS_H_ */
@@ -0,0 +1,233 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServerAutoShutdownWatcher.h"
+#include "ServerAutoShutdownSettings.h"
+#include "Log.h"
+#include "StringFormat.h"
+#include "Tokenize.h"
+#include "World.h"
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+/*static*/ ServerAutoShutdownWatcher* ServerAutoShutdownWatcher::instance()
+{
+    static ServerAutoShutdownWatcher instance;
+    return &instance;
+}
+
+ServerAutoShutdownWatcher::~ServerAutoShutdownWatcher()
+{
+    Stop();
+}
+
+/*static*/ uint64 ServerAutoShutdownWatcher::GetFileHash(std::string const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return 0;
+
+    uint64 hash = 14695981039346656037ULL;
+    std::array<char, 65536> buffer;
+
+    while (file.read(buffer.data(), buffer.size()) || file.gcount())
+    {
+        for (std::streamsize i = 0; i < file.gcount(); ++i)
+        {
+            hash ^= static_cast<uint8>(buffer[i]);
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+void ServerAutoShutdownWatcher::Start()
+{
+    Stop();
+
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    std::error_code error;
+    std::string binaryPath = std::filesystem::read_symlink("/proc/self/exe", error).string();
+    if (error)
+    {
+        LOG_ERROR("module", "> ServerAutoShutdown: Can't find the server binary to watch ({})", error.message());
+        return;
+    }
+
+    // The binary is usually replaced by a rename, so its directory is watched
+    std::vector<std::string> directories = { std::filesystem::path(binaryPath).parent_path().string() };
+
+    std::filesystem::path dataPath(sWorld->GetDataPath());
+    for (char const* name : { "dbc", "maps", "vmaps", "mmaps" })
+        directories.emplace_back((dataPath / name).string());
+
+    std::shared_ptr<SASSettings const> settings = ServerAutoShutdownSettings::Get();
+    for (auto const& directory : Acore::Tokenize(settings->DeployWatchDirs, ' ', false))
+        directories.emplace_back(directory);
+
+    _isStopping = false;
+    _thread = std::thread(&ServerAutoShutdownWatcher::Run, this, std::move(directories), std::move(binaryPath));
+#else
+    LOG_WARN("module", "> ServerAutoShutdown: The deploy watcher is only supported on Linux");
+#endif
+}
+
+void ServerAutoShutdownWatcher::Stop()
+{
+    if (!_thread.joinable())
+        return;
+
+    _isStopping = true;
+    _thread.join();
+}
+
+Optional<std::string> ServerAutoShutdownWatcher::TakeDeploy()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Optional<std::string> deploy;
+    deploy.swap(_deploy);
+    return deploy;
+}
+
+bool ServerAutoShutdownWatcher::CheckChangedFiles()
+{
+    bool isStable = true;
+
+    for (auto& [path, state] : _changedFiles)
+    {
+        std::error_code error;
+        uint64 size = std::filesystem::file_size(path, error);
+        if (error)
+            size = 0;
+
+        // Missing (deleted) files are stable as well, with size and hash 0
+        uint64 hash = size ? GetFileHash(path) : 0;
+
+        if (!state.IsChecked || state.Size != size || state.Hash != hash)
+            isStable = false;
+
+        state.IsChecked = true;
+        state.Size = size;
+        state.Hash = hash;
+    }
+
+    return isStable;
+}
+
+void ServerAutoShutdownWatcher::Run(std::vector<std::string> directories, std::string binaryPath)
+{
+#if AC_PLATFORM == AC_PLATFORM_UNIX
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG_ERROR("module", "> ServerAutoShutdown: Can't start the deploy watcher (inotify error {})", errno);
+        return;
+    }
+
+    std::map<int, std::string> watches;
+    for (std::string const& directory : directories)
+    {
+        int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+        if (wd < 0)
+        {
+            LOG_WARN("module", "> ServerAutoShutdown: Can't watch '{}' for deploys (error {})", directory, errno);
+            continue;
+        }
+
+        watches[wd] = directory;
+    }
+
+    // Content at start, a binary written again with the same content is not a deploy
+    uint64 binaryHash = GetFileHash(binaryPath);
+    std::string binaryName = std::filesystem::path(binaryPath).filename().string();
+    std::string binaryDirectory = directories.front();
+
+    LOG_INFO("module", "> ServerAutoShutdown: Deploy watcher started, {} directories", watches.size());
+
+    auto lastChangeTime = std::chrono::steady_clock::now();
+    alignas(inotify_event) std::array<char, 4096> buffer;
+
+    while (!_isStopping)
+    {
+        pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 1000) > 0)
+        {
+            ssize_t length;
+            while ((length = read(fd, buffer.data(), buffer.size())) > 0)
+            {
+                for (char* ptr = buffer.data(); ptr < buffer.data() + length; )
+                {
+                    inotify_event const* event = reinterpret_cast<inotify_event const*>(ptr);
+                    ptr += sizeof(inotify_event) + event->len;
+
+                    auto itr = watches.find(event->wd);
+                    if (itr == watches.end() || !event->len || (event->mask & IN_ISDIR))
+                        continue;
+
+                    // Only the binary itself in its directory
+                    if (itr->second == binaryDirectory && binaryName != event->name)
+                        continue;
+
+                    _changedFiles[(std::filesystem::path(itr->second) / event->name).string()] = {};
+                    lastChangeTime = std::chrono::steady_clock::now();
+                }
+            }
+        }
+
+        if (_changedFiles.empty() || std::chrono::steady_clock::now() < lastChangeTime + Seconds(ServerAutoShutdownSettings::Get()->DeployStableSeconds))
+            continue;
+
+        // Still being copied, check again after another stable time
+        if (!CheckChangedFiles())
+        {
+            lastChangeTime = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        auto binaryItr = _changedFiles.find(binaryPath);
+        if (binaryItr != _changedFiles.end() && binaryItr->second.Hash == binaryHash)
+            _changedFiles.erase(binaryItr);
+
+        if (!_changedFiles.empty())
+        {
+            for (auto const& [path, state] : _changedFiles)
+                LOG_INFO("module", "> ServerAutoShutdown: Deploy - '{}' ({} bytes, hash {:016x})", path, state.Size, state.Hash);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _deploy = Acore::StringFormatFmt("deploy of {} files", _changedFiles.size());
+        }
+
+        _changedFiles.clear();
+    }
+
+    close(fd);
+#else
+    (void)directories;
+    (void)binaryPath;
+#endif
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SERVER_AUTO_SHUTDOWN_WATCHER_H_
+#define _SERVER_AUTO_SHUTDOWN_WATCHER_H_
+
+#include "Common.h"
+#include "Optional.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Background thread watching the server binary and data directories (inotify) for a deploy
+class ServerAutoShutdownWatcher
+{
+public:
+    static ServerAutoShutdownWatcher* instance();
+
+    ~ServerAutoShutdownWatcher();
+
+    // Start the thread with the current config, restarted if it's already running
+    void Start();
+    void Stop();
+
+    // Description of a complete deploy, cleared once taken
+    Optional<std::string> TakeDeploy();
+
+    // FNV-1a of the file content, 0 if it can't be read
+    static uint64 GetFileHash(std::string const& path);
+
+private:
+    struct FileState
+    {
+        bool IsChecked = false;
+        uint64 Size = 0;
+        uint64 Hash = 0;
+    };
+
+    void Run(std::vector<std::string> directories, std::string binaryPath);
+
+    // True once every changed file kept the same size and content for a full check
+    bool CheckChangedFiles();
+
+    std::thread _thread;
+    std::atomic<bool> _isStopping{ false };
+
+    std::mutex _mutex;
+    Optional<std::string> _deploy;
+
+    // Watcher thread only
+    std::map<std::string, FileState> _changedFiles;
+};
+
+#define sSASWatcher ServerAutoShutdownWatcher::instance()
+
+#endif /* _SERVER_AUTO_SHUTDOWN_WATCHER_H_ */
@@ -16,10 +16,19 @@
  */
 
 #include "ServerAutoShutdown.h"
-#include "Config.h"
+#include "ServerAutoShutdownCost.h"
+#include "ServerAutoShutdownSampler.h"
+#include "ServerAutoShutdownSettings.h"
+#include "Chat.h"
 #include "Log.h"
+#include "Player.h"
 #include "ScriptMgr.h"
 #include "TaskScheduler.h"
+#include "Timer.h"
+#include "Util.h"
+#include "World.h"
+
+using namespace Acore::ChatCommands;
 
 class ServerAutoShutdown_World : public WorldScript
 {
@@ -33,13 +42,219 @@ public:
 
     void OnAfterConfigLoad(bool reload) override
     {
+        ServerAutoShutdownSettings::Load();
+
         if (reload)
             sSAS->Init();
     }
 
     void OnStartup() override
     {
-        sSAS->Init();
+        sSAS->OnStartup();
+    }
+
+    void OnShutdown() override
+    {
+        sSAS->OnShutdown();
+    }
+
+    void OnShutdownCancel() override
+    {
+        sSAS->OnShutdownCancel();
+    }
+};
+
+class ServerAutoShutdown_Player : public PlayerScript
+{
+public:
+    ServerAutoShutdown_Player() : PlayerScript("ServerAutoShutdown_Player") { }
+
+    bool CanJoinInBattlegroundQueue(Player* player, ObjectGuid /*battlemasterGuid*/, BattlegroundTypeId /*bgTypeId*/, uint8 /*joinAsGroup*/, GroupJoinBattlegroundResult& err) override
+    {
+        return CanJoinQueue(player, err);
+    }
+
+    bool CanJoinInArenaQueue(Player* player, ObjectGuid /*battlemasterGuid*/, uint8 /*arenaSlot*/, BattlegroundTypeId /*bgTypeId*/, uint8 /*joinAsGroup*/, uint8 /*isRated*/, GroupJoinBattlegroundResult& err) override
+    {
+        return CanJoinQueue(player, err);
+    }
+
+private:
+    static bool CanJoinQueue(Player* player, GroupJoinBattlegroundResult& err)
+    {
+        if (!sSAS->IsContentGated())
+            return true;
+
+        // The core only refuses the join with an error result, the client shows it
+        err = ERR_BATTLEGROUND_JOIN_FAILED;
+        ChatHandler(player->GetSession()).SendSysMessage(ServerAutoShutdownSettings::Get()->ContentGateMessage);
+        return false;
+    }
+};
+
+class ServerAutoShutdown_Battleground : public BGScript
+{
+public:
+    ServerAutoShutdown_Battleground() : BGScript("ServerAutoShutdown_Battleground") { }
+
+    // No match is made while closed, the players already queued don't pop into a new instance
+    bool OnQueueUpdateValidity(BattlegroundQueue* /*queue*/, uint32 /*diff*/, BattlegroundTypeId /*bgTypeId*/, BattlegroundBracketId /*bracket_id*/, uint8 /*arenaType*/, bool /*isRated*/, uint32 /*arenaRating*/) override
+    {
+        return !sSAS->IsContentGated();
+    }
+};
+
+class ServerAutoShutdown_Command : public CommandScript
+{
+public:
+    ServerAutoShutdown_Command() : CommandScript("ServerAutoShutdown_Command") { }
+
+    ChatCommandTable GetCommands() const override
+    {
+        static ChatCommandTable costCommandTable =
+        {
+            { "",      HandleCostCommand,      SEC_GAMEMASTER,    Console::Yes },
+            { "reset", HandleCostResetCommand, SEC_ADMINISTRATOR, Console::Yes }
+        };
+
+        static ChatCommandTable autoShutdownCommandTable =
+        {
+            { "cost", costCommandTable },
+            { "maps",      HandleMapsCommand,      SEC_GAMEMASTER,    Console::Yes },
+            { "memory",    HandleMemoryCommand,    SEC_GAMEMASTER,    Console::Yes },
+            { "threads",   HandleThreadsCommand,   SEC_GAMEMASTER,    Console::Yes },
+            { "restart",   HandleRestartCommand,   SEC_ADMINISTRATOR, Console::Yes },
+            { "savebench", HandleSaveBenchCommand, SEC_ADMINISTRATOR, Console::Yes }
+        };
+
+        static ChatCommandTable commandTable =
+        {
+            { "autoshutdown", autoShutdownCommandTable }
+        };
+
+        return commandTable;
+    }
+
+    static bool HandleCostCommand(ChatHandler* handler)
+    {
+        // Cold start cost, paid again by every restart
+        handler->SendSysMessage(Acore::StringFormatFmt("ServerAutoShutdown: Server start took {}", Acore::Time::ToTimeString<Seconds>(sSAS->GetStartupSeconds())));
+
+        if (!sSASCost->IsEnabled())
+        {
+            handler->SendSysMessage("ServerAutoShutdown: Self cost instrumentation is disabled (ServerAutoShutdown.SelfCost.Enabled)");
+            return true;
+        }
+
+        auto const& report = sSASCost->GetReport();
+        if (report.empty())
+        {
+            handler->SendSysMessage("ServerAutoShutdown: No calls measured yet");
+            return true;
+        }
+
+        for (std::string const& line : report)
+            handler->SendSysMessage(line);
+
+        return true;
+    }
+
+    static bool HandleMapsCommand(ChatHandler* handler, Optional<uint32> count)
+    {
+        auto const& maps = sSAS->GetMapHealth();
+        if (maps.empty())
+        {
+            handler->SendSysMessage("ServerAutoShutdown: No map data yet (ServerAutoShutdown.MapHealth.Interval)");
+            return true;
+        }
+
+        uint32 shown = 0;
+        for (SASMapHealthInfo const& info : maps)
+        {
+            if (shown++ >= count.value_or(10))
+                break;
+
+            handler->SendSysMessage(Acore::StringFormatFmt("Map {} instance {}: {} objects, {} players, state {}",
+                info.MapId, info.InstanceId, info.Objects, info.Players, uint32(info.State)));
+        }
+
+        return true;
+    }
+
+    static bool HandleMemoryCommand(ChatHandler* handler)
+    {
+        for (std::string const& line : sSASSampler->GetReport())
+            handler->SendSysMessage(line);
+
+        return true;
+    }
+
+    static bool HandleThreadsCommand(ChatHandler* handler)
+    {
+        auto const& report = sSASSampler->GetThreadReport();
+        if (report.empty())
+        {
+            handler->SendSysMessage("ServerAutoShutdown: No thread data yet (ServerAutoShutdown.Threads.Window)");
+            return true;
+        }
+
+        for (std::string const& line : report)
+            handler->SendSysMessage(line);
+
+        return true;
+    }
+
+    static bool HandleRestartCommand(ChatHandler* handler, Optional<uint32> seconds)
+    {
+        // The announce, lease and watchdog tasks only run with the module enabled
+        if (!sSAS->IsEnabled())
+        {
+            handler->SendSysMessage("ServerAutoShutdown: The module is disabled (ServerAutoShutdown.Enabled), use .server restart");
+            return true;
+        }
+
+        if (sWorld->IsShuttingDown())
+        {
+            handler->SendSysMessage("ServerAutoShutdown: The server is already shutting down");
+            return true;
+        }
+
+        sSAS->StartRestart(seconds.value_or(60), "command");
+        return true;
+    }
+
+    static bool HandleSaveBenchCommand(ChatHandler* handler, uint32 players, Optional<uint32> rowsPerPlayer, Optional<std::string> sink)
+    {
+        if (!ServerAutoShutdownSettings::Get()->SaveBenchEnabled)
+        {
+            handler->SendSysMessage("ServerAutoShutdown: The save benchmark is disabled (ServerAutoShutdown.SaveBench.Enabled)");
+            return true;
+        }
+
+        bool stub = sink && StringEqualI(*sink, "stub");
+        uint32 rows = rowsPerPlayer.value_or(50);
+
+        if (!players || !rows)
+        {
+            handler->SendSysMessage("ServerAutoShutdown: The number of players and rows must be above 0");
+            return true;
+        }
+
+        if (!sSAS->StartSaveBenchmark(players, rows, stub))
+        {
+            handler->SendSysMessage("ServerAutoShutdown: A save benchmark is already running");
+            return true;
+        }
+
+        handler->SendSysMessage("ServerAutoShutdown: Save benchmark started, the result goes to the log");
+        return true;
+    }
+
+    static bool HandleCostResetCommand(ChatHandler* handler)
+    {
+        sSASCost->Reset();
+        handler->SendSysMessage("ServerAutoShutdown: Self cost counters reset");
+        return true;
     }
 };
 
@@ -47,4 +262,7 @@ public:
 void AddSC_ServerAutoShutdown()
 {
     new ServerAutoShutdown_World();
+    new ServerAutoShutdown_Player();
+    new ServerAutoShutdown_Battleground();
+    new ServerAutoShutdown_Command();
 }